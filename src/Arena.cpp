@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2012 Chammika Mannakkara
+ *
+ *    Arena.cpp - Implementation of the per-thread arenas
+ *
+ *    This is a part of simple tool calculate the PageRank
+ *
+ *    This source code is free software; you can redistribute it
+ *    and/or modify it in source code form under the terms of the GNU
+ *    General Public License as published by the Free Software
+ *    Foundation; either version 2 of the License, or (at your option)
+ *    any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+#include <atomic>
+
+#include "Arena.h"
+#include "defaults.h"
+
+// arena IDs are never reused : a thread's cached buffer is valid only while
+// the ID it was cached for is the arena's current one
+static std::atomic<unsigned long long> next_arena_id(1);
+
+Arena::ThreadBuffer::ThreadBuffer(std::thread::id id)
+  : owner(id), resource(ARENA_BLOCK_SIZE) { }
+
+Arena::Arena() : id_(next_arena_id++) { }
+
+Arena::~Arena() {
+  release();
+}
+
+void Arena::release() {
+  std::lock_guard<std::mutex> lock( lock_);
+  vector<std::unique_ptr<ThreadBuffer> >().swap(buffers_);
+  id_ = next_arena_id++;
+}
+
+// The cache holds a few arenas per thread (the Network allocates from two in
+// turns), indexed by arena ID. A miss looks the thread up under the lock.
+Arena::ThreadBuffer* Arena::local() {
+  struct CacheEntry {
+    unsigned long long arena;
+    ThreadBuffer* buffer;
+  };
+  thread_local CacheEntry cache[ARENA_THREAD_CACHE] = { };
+  CacheEntry& entry = cache[id_ % ARENA_THREAD_CACHE];
+  if (entry.arena == id_) {
+    return entry.buffer;
+  }
+
+  std::lock_guard<std::mutex> lock( lock_);
+  std::thread::id self = std::this_thread::get_id();
+  ThreadBuffer* buffer = 0;
+  for (size_t i = 0; i < buffers_.size() && !buffer; ++i) {
+    if (buffers_[i]->owner == self) {
+      buffer = buffers_[i].get();
+    }
+  }
+  if (!buffer) {
+    buffers_.emplace_back( new ThreadBuffer( self));
+    buffer = buffers_.back().get();
+  }
+  entry.arena = id_;
+  entry.buffer = buffer;
+  return buffer;
+}
+
+void* Arena::do_allocate(size_t bytes, size_t alignment) {
+  return local()->resource.allocate(bytes, alignment);
+}
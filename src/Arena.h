@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2012 Chammika Mannakkara
+ *
+ *    Arena.h - Monotonic per-thread arenas for the Network link sets
+ *
+ *    This is a part of simple tool calculate the PageRank
+ *
+ *    This source code is free software; you can redistribute it
+ *    and/or modify it in source code form under the terms of the GNU
+ *    General Public License as published by the Free Software
+ *    Foundation; either version 2 of the License, or (at your option)
+ *    any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+#ifndef PAGERANK_ARENA
+#define PAGERANK_ARENA
+
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#include "types.h"
+
+// Arena class - the memory of the Network link sets (one tree node per edge).
+// Each thread allocating from the arena gets its own monotonic buffer, so the
+// concurrent build (add_edges_parallel) needs no locking, and nothing is ever
+// freed one by one : deallocate() is a no-op and release() returns all the
+// buffers at once, in O(number of buffers).
+class Arena : public std::pmr::memory_resource {
+
+public:
+  Arena(); // ctor
+  ~Arena(); // dtor - releases the buffers
+
+  // free all the memory allocated from the arena : the sets living in it
+  // must not be used (nor destroyed) afterwards
+  void release();
+
+private:
+  struct ThreadBuffer {
+    std::thread::id owner;
+    std::pmr::monotonic_buffer_resource resource;
+    explicit ThreadBuffer(std::thread::id id);
+  };
+
+  std::mutex lock_; // guards buffers_
+  vector<std::unique_ptr<ThreadBuffer> > buffers_;
+  unsigned long long id_; // unique over the program, renewed by release()
+
+  // buffer of the calling thread (cached per thread)
+  ThreadBuffer* local();
+
+  void* do_allocate(size_t bytes, size_t alignment) override;
+  void do_deallocate(void*, size_t, size_t) override { }
+  bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+    return this == &other;
+  }
+
+  Arena( const Arena&); // copy ctor -not allowed
+  Arena& operator=( const Arena&); // assignment operator -not allowed
+};
+
+// ArenaAllocator - allocator of the per node vector<> of link sets. The
+// vector itself lives on the heap, the sets are constructed on the arena and
+// never destroyed : their tree nodes go with Arena::release(), so dropping
+// the vector does not visit the edges.
+template<typename T>
+struct ArenaAllocator {
+  typedef T value_type;
+  typedef std::true_type propagate_on_container_move_assignment;
+  typedef std::true_type propagate_on_container_swap;
+
+  std::pmr::memory_resource* arena_;
+
+  explicit ArenaAllocator(std::pmr::memory_resource* arena) : arena_(arena) { }
+  template<typename U> ArenaAllocator(const ArenaAllocator<U>& other) : arena_(other.arena_) { }
+
+  T* allocate(size_t n) { return std::allocator<T>().allocate( n); }
+  void deallocate(T* p, size_t n) { std::allocator<T>().deallocate(p, n); }
+
+  template<typename U, typename... Args> void construct(U* p, Args&&... args) {
+    ::new(static_cast<void*>(p)) U(std::forward<Args>(args)..., arena_);
+  }
+  template<typename U> void destroy(U*) { }
+
+  template<typename U> bool operator==(const ArenaAllocator<U>& other) const { return arena_ == other.arena_; }
+  template<typename U> bool operator!=(const ArenaAllocator<U>& other) const { return arena_ != other.arena_; }
+};
+
+template<typename T>
+using arena_vector = std::vector<T, ArenaAllocator<T> >;
+
+#endif
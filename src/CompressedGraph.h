@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2012 Chammika Mannakkara
+ *
+ *    CompressedGraph.h - Compressed sparse row (CSR) form of the Network
+ *                        links used by the PageRank solvers
+ *
+ *    This is a part of simple tool calculate the PageRank
+ *
+ *    This source code is free software; you can redistribute it
+ *    and/or modify it in source code form under the terms of the GNU
+ *    General Public License as published by the Free Software
+ *    Foundation; either version 2 of the License, or (at your option)
+ *    any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+#ifndef PAGERANK_COMPRESSED_GRAPH
+#define PAGERANK_COMPRESSED_GRAPH
+
+#include <cstddef>
+
+#include "types.h"
+#include "Parallel.h"
+
+// CompressedGraph - read-only link structure of a Network in compressed sparse
+// row (CSR) form. Row i holds the IDs of the nodes linking TO node i (ie. the
+// transposed adjacency matrix), which is the access pattern of the pull-style
+// PageRank sweep: one contiguous pass over links_ per iteration.
+// Edge attributes are not stored per edge: the PageRank transfer factor 1/L(j)
+// depends on the source node only and is kept once per node in out_weight_.
+// The decay factor is applied by the solver, so one CompressedGraph serves any
+// number of decay factors.
+// Index is the type of the node IDs in links_ : 32-bit IDs halve the memory
+// traffic of the sweep, 64-bit IDs are needed for more than 2^32 nodes.
+// The arrays are numa_vector's : in NUMA mode the worker sweeping a range of
+// rows owns (first touches) that range of row_offsets_, links_ and out_weight_.
+template<typename Index>
+struct CompressedGraph {
+  typedef Index index_type;
+
+  Index num_nodes() const { return out_weight_.size(); }
+  size_t num_links() const { return links_.size(); }
+
+  // first row of part 'part' when the rows are split into num_parts parts
+  // holding (about) the same number of links
+  Index row_partition(unsigned int num_parts, unsigned int part) const {
+    if (part >= num_parts) return num_nodes();
+    size_t target = (num_links() / num_parts) * part;
+    return std::lower_bound(row_offsets_.begin(), row_offsets_.end() - 1, target)
+      - row_offsets_.begin();
+  }
+  // first node of part 'part' for the per node passes (prescaling the ranks) :
+  // even split, or in NUMA mode the rows of row_partition() so that a worker
+  // touches the same ranks in all passes
+  Index node_partition(unsigned int num_parts, unsigned int part) const {
+    return Numa::enabled_? row_partition(num_parts, part) : partition_begin(num_nodes(), num_parts, part);
+  }
+
+  numa_vector<size_t> row_offsets_;    // links of row i : links_[row_offsets_[i] .. row_offsets_[i+1])
+  numa_vector<Index> links_;           // source node IDs, sorted within each row
+  numa_vector<attr_type> out_weight_;  // transfer factor 1/L(j) of node j (0 for rank leaks)
+};
+
+// Reversed link structure of g : row j of t holds the nodes j links to (the
+// forward adjacency when g holds the in-links), sorted, and t.out_weight_[i]
+// is 1 / (number of links in row i of g), 0 for an empty row.
+// Complexity : O(N + E)
+template<typename Index>
+void transpose(const CompressedGraph<Index>& g, CompressedGraph<Index>& t) {
+  const Index N = g.num_nodes();
+  t.out_weight_.resize( N);
+  t.row_offsets_.assign( N + 1, 0);
+  for (size_t l = 0; l < g.num_links(); ++l) {
+    ++t.row_offsets_[g.links_[l] + 1];
+  }
+  std::partial_sum(t.row_offsets_.begin(), t.row_offsets_.end(), t.row_offsets_.begin());
+  t.links_.resize( g.num_links());
+  vector<size_t> fill_pos( t.row_offsets_.begin(), t.row_offsets_.end() - 1);
+  for (Index i = 0; i < N; ++i) { // rows of g in increasing order : t rows come out sorted
+    size_t length = g.row_offsets_[i+1] - g.row_offsets_[i];
+    t.out_weight_[i] = length? 1.0 / length : 0.0;
+    for (size_t l = g.row_offsets_[i]; l < g.row_offsets_[i+1]; ++l) {
+      t.links_[fill_pos[g.links_[l]]++] = i;
+    }
+  }
+}
+
+#endif
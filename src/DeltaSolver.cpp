@@ -0,0 +1,286 @@
+/*
+ * Copyright (c) 2012 Chammika Mannakkara
+ *
+ *    DeltaSolver.cpp - Implementation of the delta-PageRank solver
+ *
+ *    This is a part of simple tool calculate the PageRank
+ *
+ *    This source code is free software; you can redistribute it
+ *    and/or modify it in source code form under the terms of the GNU
+ *    General Public License as published by the Free Software
+ *    Foundation; either version 2 of the License, or (at your option)
+ *    any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+#include "DeltaSolver.h"
+#include "Parallel.h"
+#include "PerfCounters.h"
+#include "Log.h"
+
+// ctor
+template<typename Index>
+DeltaSolver<Index>::DeltaSolver(const CompressedGraph<Index>& links, rank_type decay,
+				unsigned int num_threads)
+  : in_links_(links), decay_(decay), num_threads_(num_threads), threshold_(0.0), push_rounds_(0), pull_rounds_(0),
+    links_visited_(0) { }
+
+// L(j) : out_weight_ is 1/L(j), 0 for a node without out-links
+template<typename Index>
+Index DeltaSolver<Index>::num_out_links(Index j) const {
+  attr_type weight = in_links_.out_weight_[j];
+  return weight? (Index) (1.0 / weight + 0.5) : 0;
+}
+
+// Algorithm :
+// 1. ranks = x, r = b - x + d P^T x (one pull sweep), frontier = {j : |r(j)| > epsilon}
+// 2. Each round : pull if |F| + out-links of F > E / DELTA_PULL_DIVISOR,
+//    else push ; then ranks(F) += r(F), r(F) = 0, r += d P^T r(F)
+// 3. Empty frontier : done if max |d P^T r| < epsilon (one pull sweep), else
+//    the threshold is lowered by DELTA_THRESHOLD_DIVISOR and back to 2.
+// 4. x = ranks + r
+// Complexity : O(E) per pull round, O(T x |F| log(L) + out-links of F) per
+// push round (T threads)
+template<typename Index>
+unsigned int DeltaSolver<Index>::solve(const vector<rank_type>& b, vector<rank_type>& x,
+				       unsigned int max_rounds, rank_type epsilon) {
+  const Index N = in_links_.num_nodes();
+  const unsigned int num_threads = num_threads_;
+  threshold_ = (epsilon == NO_CONVERGENCE_CHECK)? 0.0 : epsilon;
+  push_rounds_ = pull_rounds_ = 0;
+  links_visited_ = 0;
+  ranks_.resize( N);
+  residual_.resize( N);
+  incoming_.resize( N);
+  scaled_.resize( N);
+  touched_.assign( N, 0);
+  frontier_.assign( num_threads, vector<Index>());
+  frontier_links_.assign( num_threads, 0);
+  change_.assign( num_threads, 0.0);
+
+  // 1. residual of the guess and first frontier
+  parallel_run(num_threads, [&](unsigned int t) { // first touch by the worker of the rows
+    Index last = in_links_.node_partition(num_threads, t+1);
+    for (Index j = in_links_.node_partition(num_threads, t); j < last; ++j) {
+      ranks_[j] = x[j];
+      scaled_[j] = x[j] * in_links_.out_weight_[j];
+      incoming_[j] = 0.0;
+    }
+  });
+  parallel_run(num_threads, [&](unsigned int t) {
+    Index first = in_links_.row_partition(num_threads, t), last = in_links_.row_partition(num_threads, t+1);
+    sweep_rows<double, Index>(in_links_, scaled_.data(), residual_.data(), first, last, decay_, 0.0);
+    for (Index i = first; i < last; ++i) {
+      residual_[i] += b[i] - x[i];
+    }
+  });
+  links_visited_ += in_links_.num_links();
+  find_frontier();
+
+  // 2. rounds
+  unsigned int k = 0;
+  while (k < max_rounds) {
+    size_t num_active = 0, active_links = 0;
+    for (unsigned int t = 0; t < num_threads; ++t) {
+      num_active += frontier_[t].size();
+      active_links += frontier_links_[t];
+    }
+    if (!num_active) {
+      // residuals below the threshold still add up at nodes with many in-links
+      double change = (threshold_ > 0.0)? residual_change() : 0.0;
+      if (change < epsilon || threshold_ == 0.0) {
+	PRINT(LOG_LVL_2, "PageRanks converged within the given accuracy." << endl);
+	break;
+      }
+      do {
+	threshold_ /= DELTA_THRESHOLD_DIVISOR;
+	find_frontier();
+      } while (frontier_empty());
+      PRINT(LOG_LVL_2, "Residuals left change the ranks by " << change << " : threshold lowered to "
+	    << threshold_ << endl);
+      continue;
+    }
+    ++k;
+    bool pull = num_active + active_links > in_links_.num_links() / DELTA_PULL_DIVISOR;
+    PRINT(LOG_LVL_2, "Round #" << k << " : " << (pull? "pull, " : "push, ") << num_active
+	  << " active node(s), " << active_links << " out-link(s)" << endl);
+    size_t round_links = pull? in_links_.num_links() : active_links;
+    PerfScope perf_round(pull? "pull" : "push", round_links, k);
+    if (pull) {
+      pull_round();
+      ++pull_rounds_;
+    }
+    else {
+      push_round();
+      ++push_rounds_;
+    }
+    links_visited_ += round_links;
+    if (progress_ && !progress_(k, *std::max_element(change_.begin(), change_.end()))) {
+      break;
+    }
+  }
+
+  // 4. ranks and the residuals left
+  x.resize( N);
+  parallel_run(num_threads, [&](unsigned int t) {
+    Index last = in_links_.node_partition(num_threads, t+1);
+    for (Index j = in_links_.node_partition(num_threads, t); j < last; ++j) {
+      x[j] = ranks_[j] + residual_[j];
+    }
+  });
+  return k;
+}
+
+template<typename Index>
+void DeltaSolver<Index>::find_frontier() {
+  const unsigned int num_threads = num_threads_;
+  parallel_run(num_threads, [&](unsigned int t) {
+    frontier_[t].clear();
+    frontier_links_[t] = 0;
+    Index last = in_links_.node_partition(num_threads, t+1);
+    for (Index j = in_links_.node_partition(num_threads, t); j < last; ++j) {
+      if (active( residual_[j])) {
+	frontier_[t].push_back( j);
+	frontier_links_[t] += num_out_links( j);
+      }
+    }
+  });
+}
+
+template<typename Index>
+bool DeltaSolver<Index>::frontier_empty() const {
+  for (const vector<Index>& frontier : frontier_) {
+    if (!frontier.empty()) return false;
+  }
+  return true;
+}
+
+// max |d P^T r| : the change one power iteration would make to ranks + r
+template<typename Index>
+double DeltaSolver<Index>::residual_change() {
+  const unsigned int num_threads = num_threads_;
+  parallel_run(num_threads, [&](unsigned int t) {
+    Index last = in_links_.node_partition(num_threads, t+1);
+    for (Index j = in_links_.node_partition(num_threads, t); j < last; ++j) {
+      scaled_[j] = residual_[j] * in_links_.out_weight_[j];
+    }
+  });
+  vector<double> change( num_threads);
+  parallel_run(num_threads, [&](unsigned int t) {
+    Index first = in_links_.row_partition(num_threads, t), last = in_links_.row_partition(num_threads, t+1);
+    sweep_rows<double, Index>(in_links_, scaled_.data(), incoming_.data(), first, last, decay_, 0.0);
+    double max = 0.0;
+    for (Index i = first; i < last; ++i) {
+      max = std::max(max, fabs(incoming_[i]));
+      incoming_[i] = 0.0;
+    }
+    change[t] = max;
+  });
+  links_visited_ += in_links_.num_links();
+  return *std::max_element(change.begin(), change.end());
+}
+
+// Dense round : incoming = d P^T r(F) by a pull sweep over all the in-links,
+// the residual of the inactive nodes prescaled to 0
+template<typename Index>
+void DeltaSolver<Index>::pull_round() {
+  const unsigned int num_threads = num_threads_;
+  parallel_run(num_threads, [&](unsigned int t) {
+    Index last = in_links_.node_partition(num_threads, t+1);
+    for (Index j = in_links_.node_partition(num_threads, t); j < last; ++j) {
+      scaled_[j] = active( residual_[j])? residual_[j] * in_links_.out_weight_[j] : 0.0;
+    }
+  });
+  parallel_run(num_threads, [&](unsigned int t) {
+    sweep_rows<double, Index>(in_links_, scaled_.data(), incoming_.data(), in_links_.row_partition(num_threads, t),
+			      in_links_.row_partition(num_threads, t+1), decay_, 0.0);
+  });
+  parallel_run(num_threads, [&](unsigned int t) {
+    vector<Index>& frontier = frontier_[t];
+    frontier.clear();
+    frontier_links_[t] = 0;
+    double change = 0.0;
+    Index last = in_links_.node_partition(num_threads, t+1);
+    for (Index j = in_links_.node_partition(num_threads, t); j < last; ++j) {
+      if (active( residual_[j])) { // in this round's frontier
+	change = std::max(change, fabs(residual_[j]));
+	ranks_[j] += residual_[j];
+	residual_[j] = 0.0;
+      }
+      residual_[j] += incoming_[j];
+      incoming_[j] = 0.0;
+      if (active( residual_[j])) {
+	frontier.push_back( j);
+	frontier_links_[t] += num_out_links( j);
+      }
+    }
+    change_[t] = change;
+  });
+}
+
+// Sparse round : each thread adds d r(j)/L(j) of every frontier node j to
+// the out-links of j in its own range of nodes (rows of out_links_ are
+// sorted : binary search for the range), in frontier order. The next
+// frontier can only hold nodes reached by the push.
+template<typename Index>
+void DeltaSolver<Index>::push_round() {
+  const unsigned int num_threads = num_threads_;
+  if (out_links_.num_nodes() != in_links_.num_nodes()) {
+    PRINT(LOG_LVL_2, "Building the forward link structure..." << endl);
+    transpose(in_links_, out_links_);
+  }
+  vector<Index> frontier; // whole frontier, in ID order
+  vector<double> value;   // d r(j)/L(j) pushed along each link of j
+  for (unsigned int t = 0; t < num_threads; ++t) {
+    for (Index j : frontier_[t]) {
+      frontier.push_back( j);
+      value.push_back( decay_ * residual_[j] * in_links_.out_weight_[j]);
+    }
+  }
+  parallel_run(num_threads, [&](unsigned int t) {
+    const Index first = in_links_.node_partition(num_threads, t);
+    const Index last = in_links_.node_partition(num_threads, t+1);
+    vector<Index> reached;
+    for (size_t f = 0; f < frontier.size(); ++f) {
+      const Index* row_begin = &out_links_.links_[0] + out_links_.row_offsets_[frontier[f]];
+      const Index* row_end = &out_links_.links_[0] + out_links_.row_offsets_[frontier[f] + 1];
+      for (const Index* i = std::lower_bound(row_begin, row_end, first); i != row_end && *i < last; ++i) {
+	incoming_[*i] += value[f];
+	if (!touched_[*i]) {
+	  touched_[*i] = 1;
+	  reached.push_back( *i);
+	}
+      }
+    }
+    vector<Index>& next = frontier_[t];
+    double change = 0.0;
+    for (Index j : next) { // this round's frontier in the range
+      change = std::max(change, fabs(residual_[j]));
+      ranks_[j] += residual_[j];
+      residual_[j] = 0.0;
+    }
+    change_[t] = change;
+    next.clear();
+    frontier_links_[t] = 0;
+    sort(reached.begin(), reached.end());
+    for (Index i : reached) {
+      residual_[i] += incoming_[i];
+      incoming_[i] = 0.0;
+      touched_[i] = 0;
+      if (active( residual_[i])) {
+	next.push_back( i);
+	frontier_links_[t] += num_out_links( i);
+      }
+    }
+  });
+}
+
+template class DeltaSolver<unsigned int>;
+template class DeltaSolver<unsigned long long>;
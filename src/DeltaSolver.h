@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2012 Chammika Mannakkara
+ *
+ *    DeltaSolver.h - Delta-PageRank with direction optimizing push/pull
+ *                    rounds
+ *
+ *    This is a part of simple tool calculate the PageRank
+ *
+ *    This source code is free software; you can redistribute it
+ *    and/or modify it in source code form under the terms of the GNU
+ *    General Public License as published by the Free Software
+ *    Foundation; either version 2 of the License, or (at your option)
+ *    any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+#ifndef PAGERANK_DELTA_SOLVER
+#define PAGERANK_DELTA_SOLVER
+
+#include <cmath>
+
+#include "types.h"
+#include "CompressedGraph.h"
+#include "SweepKernels.h"
+#include "defaults.h"
+
+// DeltaSolver class - solves x = d P^T x + b (the PageRanks for b = (1-d)/N)
+// by propagating rank changes only. The solver keeps the ranks and the
+// residual r = b - (I - d P^T) x, the change not propagated yet. A round
+// moves the residual of the frontier (the nodes with |r| above epsilon) into
+// their ranks and adds d r(j)/L(j) to the residual of each node j links to,
+// so nodes which have converged cost nothing. Once no residual is above the
+// threshold (epsilon at first), the residuals left may still add up to a
+// change above epsilon at nodes with many in-links : the threshold is then
+// lowered and the rounds go on.
+// Direction optimization (as in Beamer's BFS) : a round pushes along the
+// out-links of the frontier (forward link structure, sparse) while the
+// frontier and its out-links are less than 1/DELTA_PULL_DIVISOR of the links,
+// and pulls over all the in-links (dense sweep, SweepKernels.h) otherwise.
+// A push is split by destination : each thread adds the frontier's
+// contributions to its own range of nodes, without atomics, and in the same
+// order as the pull sweep, so both directions give the same sums.
+template<typename Index>
+class DeltaSolver {
+
+public:
+  // the rounds run on num_threads threads
+  DeltaSolver(const CompressedGraph<Index>& links, rank_type decay,
+	      unsigned int num_threads); // ctor
+
+  // solve for x starting from the guess in x, for at most max_rounds rounds
+  // or until no residual is above epsilon (NO_CONVERGENCE_CHECK : all
+  // rounds, every node with a residual is in the frontier). x receives the
+  // ranks plus the residuals left. Returns the number of rounds.
+  unsigned int solve(const vector<rank_type>& b, vector<rank_type>& x, unsigned int max_rounds,
+		     rank_type epsilon);
+
+  // called after each round with the max change it made to a rank :
+  // returning false stops the rounds
+  void set_progress(const ProgressCallback& progress) { progress_ = progress; }
+
+  // Statistics of the last solve() :
+  unsigned int push_rounds() const { return push_rounds_; }
+  unsigned int pull_rounds() const { return pull_rounds_; }
+  size_t links_visited() const { return links_visited_; }
+
+private:
+  typedef numa_vector<double> Vec;
+
+  const CompressedGraph<Index>& in_links_;
+  CompressedGraph<Index> out_links_; // forward links, built on the first push
+  rank_type decay_;
+  unsigned int num_threads_;
+
+  Vec ranks_, residual_;
+  Vec incoming_; // d P^T r of the frontier, in the current round
+  Vec scaled_;   // working space of the pull rounds
+  vector<char> touched_; // incoming_ written by a push
+  // frontier of each thread (nodes of its range, sorted) and its out-links
+  vector<vector<Index> > frontier_;
+  vector<size_t> frontier_links_;
+  vector<double> change_; // max |r| moved into a rank by each thread, in the round
+  rank_type threshold_;
+  ProgressCallback progress_;
+
+  unsigned int push_rounds_, pull_rounds_;
+  size_t links_visited_;
+
+  bool active(double residual) const { return fabs(residual) > threshold_; }
+  Index num_out_links(Index j) const;
+
+  // frontier_ of the current residuals
+  void find_frontier();
+  bool frontier_empty() const;
+  // max |d P^T r| : the change one power iteration would make, incoming_ is
+  // left zero
+  double residual_change();
+
+  // one round : incoming_ from the frontier, then the frontier moved into
+  // the ranks and the next frontier found
+  void pull_round();
+  void push_round();
+
+  DeltaSolver( const DeltaSolver&); // copy ctor -not allowed
+  DeltaSolver& operator=( const DeltaSolver&); // assignment operator -not allowed
+};
+
+#endif
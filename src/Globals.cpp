@@ -0,0 +1,38 @@
+/*
+ * Copyright (c) 2012 Chammika Mannakkara
+ *
+ *    Globals.cpp - Program globals, in the library (libpagerank) so that the
+ *                  pagerank tool and embedding programs share them
+ *
+ *    This is a part of simple tool calculate the PageRank
+ *
+ *    This source code is free software; you can redistribute it
+ *    and/or modify it in source code form under the terms of the GNU
+ *    General Public License as published by the Free Software
+ *    Foundation; either version 2 of the License, or (at your option)
+ *    any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+#include <cstdio>
+#include <iostream>
+
+#include "Log.h"
+#include "Parallel.h"
+#include "Numa.h"
+#include "PerfCounters.h"
+#include "defaults.h"
+
+// Program Globals
+unsigned char Log::level_ = DEFAULT_LOG_LEVEL;
+std::ostream* Log::out_ = &std::cout;
+unsigned int Parallel::num_threads_ = DEFAULT_NUM_THREADS;
+bool Numa::enabled_ = false;
+bool PerfCounters::enabled_ = false;
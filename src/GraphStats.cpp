@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2012 Chammika Mannakkara
+ *
+ *    GraphStats.cpp - Implementation of the graph and machine statistics
+ *
+ *    This is a part of simple tool calculate the PageRank
+ *
+ *    This source code is free software; you can redistribute it
+ *    and/or modify it in source code form under the terms of the GNU
+ *    General Public License as published by the Free Software
+ *    Foundation; either version 2 of the License, or (at your option)
+ *    any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+#include <cstdio>
+#include <cstring>
+#include <unistd.h>
+
+#include "GraphStats.h"
+#include "defaults.h"
+
+template<typename Index>
+void link_stats(const CompressedGraph<Index>& links, GraphStats& stats, unsigned int num_threads) {
+  const Index N = links.num_nodes();
+  vector<size_t> max_row( num_threads, 0), near( num_threads, 0);
+  parallel_run(num_threads, [&](unsigned int t) {
+    Index last = links.row_partition(num_threads, t+1);
+    for (Index i = links.row_partition(num_threads, t); i < last; ++i) {
+      size_t first = links.row_offsets_[i], end = links.row_offsets_[i+1];
+      max_row[t] = std::max(max_row[t], end - first);
+      for (size_t l = first; l < end; ++l) {
+	Index j = links.links_[l];
+	near[t] += ((j > i)? j - i : i - j) < PLAN_LOCALITY_WINDOW;
+      }
+    }
+  });
+  stats.nodes = N;
+  stats.links = links.num_links();
+  stats.max_in_links = *std::max_element(max_row.begin(), max_row.end());
+  stats.skew = stats.links? (double) stats.max_in_links * N / stats.links : 0.0;
+  stats.locality = stats.links? (double) accumulate(near.begin(), near.end(), (size_t) 0) / stats.links : 1.0;
+}
+
+// MemAvailable of /proc/meminfo (free memory plus reclaimable caches), or the
+// free pages
+void machine_stats(GraphStats& stats) {
+  stats.cores = std::thread::hardware_concurrency();
+  stats.memory = 0;
+  FILE* meminfo = fopen("/proc/meminfo", "r");
+  if (meminfo) {
+    char line[256];
+    unsigned long long kb;
+    while (fgets(line, sizeof(line), meminfo)) {
+      if (sscanf(line, "MemAvailable: %llu kB", &kb) == 1) {
+	stats.memory = kb * 1024;
+	break;
+      }
+    }
+    fclose( meminfo);
+  }
+  if (!stats.memory) {
+    long pages = sysconf(_SC_AVPHYS_PAGES), page_size = sysconf(_SC_PAGESIZE);
+    if (pages > 0 && page_size > 0) {
+      stats.memory = (unsigned long long) pages * page_size;
+    }
+  }
+}
+
+ostream& operator<<(ostream& os, const GraphStats& stats) {
+  os << "  nodes " << stats.nodes << ", links " << stats.links << endl
+     << "  in-links : max " << stats.max_in_links << ", skew (max/mean) " << stats.skew << endl
+     << "  dangling nodes " << 100.0 * stats.dangling << "%" << endl
+     << "  components ";
+  if (stats.components) {
+    os << stats.components << ", largest " << stats.largest_component << " nodes" << endl;
+  }
+  else {
+    os << "not counted" << endl;
+  }
+  os
+     << "  locality " << 100.0 * stats.locality << "% of the links within " << PLAN_LOCALITY_WINDOW << " IDs" << endl
+     << "  memory available " << (stats.memory >> 20) << " MB, " << stats.cores << " core(s)" << endl;
+  return os;
+}
+
+template void link_stats(const CompressedGraph<unsigned int>& links, GraphStats& stats,
+			unsigned int num_threads);
+template void link_stats(const CompressedGraph<unsigned long long>& links, GraphStats& stats,
+			unsigned int num_threads);
@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2012 Chammika Mannakkara
+ *
+ *    GraphStats.h - Cheap statistics of a link structure and of the machine,
+ *                   the inputs of the execution planner
+ *
+ *    This is a part of simple tool calculate the PageRank
+ *
+ *    This source code is free software; you can redistribute it
+ *    and/or modify it in source code form under the terms of the GNU
+ *    General Public License as published by the Free Software
+ *    Foundation; either version 2 of the License, or (at your option)
+ *    any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+#ifndef PAGERANK_GRAPH_STATS
+#define PAGERANK_GRAPH_STATS
+
+#include "CompressedGraph.h"
+
+// GraphStats - what the execution planner (PageRank::make_plan()) knows of a
+// network and of the machine it runs on. The link statistics take one pass
+// over the link structure, the components one more (Tarjan).
+struct GraphStats {
+  size_t nodes, links;       // links of the link structure : leak fixing links included
+  size_t max_in_links;       // largest row
+  double skew;               // max / mean in-links
+  double dangling;           // fraction of rank leaks (nodes without out-links)
+  size_t components;         // strongly connected components (0 : not counted)
+  size_t largest_component;  // nodes of the largest one
+  double locality;           // fraction of the links within PLAN_LOCALITY_WINDOW IDs
+  unsigned long long memory; // available memory (bytes, 0 : unknown)
+  unsigned int cores;        // hardware threads (0 : unknown)
+};
+
+// nodes, links, skew and locality of the link structure, O(E) over
+// num_threads threads
+template<typename Index>
+void link_stats(const CompressedGraph<Index>& links, GraphStats& stats, unsigned int num_threads);
+
+// available memory and cores
+void machine_stats(GraphStats& stats);
+
+// one line per statistic
+ostream& operator<<(ostream& os, const GraphStats& stats);
+
+#endif
@@ -0,0 +1,364 @@
+/*
+ * Copyright (c) 2012 Chammika Mannakkara
+ *
+ *    InputStream.cpp - Implementation of the network file input layer
+ *
+ *    This is a part of simple tool calculate the PageRank
+ *
+ *    This source code is free software; you can redistribute it
+ *    and/or modify it in source code form under the terms of the GNU
+ *    General Public License as published by the Free Software
+ *    Foundation; either version 2 of the License, or (at your option)
+ *    any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#include "InputStream.h"
+#include "Parallel.h"
+#include "Log.h"
+
+// compressed input is read in chunks of this size
+#define COMPRESSED_CHUNK_SIZE (1 << 20)
+// number of BGZF blocks (up to 64 KB each) inflated in one parallel batch
+#define BGZF_BATCH_BLOCKS 256
+// zstd input is split into frames from chunks of this size
+#define ZSTD_BATCH_SIZE (16 << 20)
+
+// read up to len bytes : first the bytes handed back by unread()
+ssize_t ByteSource::read(char* buf, size_t len) {
+  if (pushback_pos_ < pushback_.size()) {
+    size_t n = std::min(len, pushback_.size() - pushback_pos_);
+    memcpy(buf, pushback_.data() + pushback_pos_, n);
+    pushback_pos_ += n;
+    bytes_read_ += n;
+    return n;
+  }
+  while (true) {
+    ssize_t n = ::read(fd_, buf, len);
+    if (n < 0 && errno == EINTR) continue;
+    if (n < 0) {
+      ERROR("Read error : " << strerror(errno) << endl);
+    }
+    else {
+      bytes_read_ += n;
+    }
+    return n;
+  }
+}
+
+// read until len bytes or end of input
+ssize_t ByteSource::read_fully(char* buf, size_t len) {
+  size_t done = 0;
+  while (done < len) {
+    ssize_t n = read(buf + done, len - done);
+    if (n < 0) return -1;
+    if (n == 0) break;
+    done += n;
+  }
+  return done;
+}
+
+// Plain text input
+class RawInput : public InputStream {
+public:
+  RawInput(int fd) : InputStream(fd) { }
+  ssize_t read(char* buf, size_t len) { return source_.read(buf, len); }
+  const char* format() const { return "text"; }
+};
+
+// Base of the decoders which produce their output in batches : read() serves
+// the current batch and asks decode_batch() for the next one when it is used up
+class BatchInput : public InputStream {
+public:
+  ssize_t read(char* buf, size_t len) {
+    while (out_pos_ == out_.size()) {
+      out_.clear();
+      out_pos_ = 0;
+      ssize_t n = decode_batch();
+      if (n <= 0) return n; // end of input or error
+    }
+    size_t n = std::min(len, out_.size() - out_pos_);
+    memcpy(buf, out_.data() + out_pos_, n);
+    out_pos_ += n;
+    return n;
+  }
+
+protected:
+  BatchInput(int fd, unsigned int num_threads)
+    : InputStream(fd), num_threads_(num_threads), out_pos_(0) { }
+  // decode the next batch into out_, returns its size, 0 at end of input, -1 on errors
+  virtual ssize_t decode_batch() = 0;
+
+  unsigned int num_threads_;
+  string out_;
+  size_t out_pos_;
+};
+
+#ifdef HAVE_ZLIB
+// gzip input : streaming inflate, concatenated gzip members are read one after another
+class GzipInput : public InputStream {
+public:
+  GzipInput(int fd) : InputStream(fd), in_(COMPRESSED_CHUNK_SIZE, '\0'), eof_(false) {
+    memset(&zs_, 0, sizeof(zs_));
+    inflateInit2(&zs_, 15 + 16); // gzip header
+  }
+  ~GzipInput() { inflateEnd(&zs_); }
+  const char* format() const { return "gzip"; }
+
+  ssize_t read(char* buf, size_t len) {
+    zs_.next_out = reinterpret_cast<Bytef*>(buf);
+    zs_.avail_out = len;
+    while (zs_.avail_out == len) { // until some output or end of input
+      if (zs_.avail_in == 0) {
+	if (eof_) break;
+	ssize_t n = source_.read(&in_[0], in_.size());
+	if (n < 0) return -1;
+	if (n == 0) { eof_ = true; break; }
+	zs_.next_in = reinterpret_cast<Bytef*>(&in_[0]);
+	zs_.avail_in = n;
+      }
+      int ret = inflate(&zs_, Z_NO_FLUSH);
+      if (ret == Z_STREAM_END) {
+	inflateReset(&zs_); // next member (if any)
+      }
+      else if (ret != Z_OK && ret != Z_BUF_ERROR) {
+	ERROR("gzip : corrupt input (" << (zs_.msg? zs_.msg : "inflate error") << ")" << endl);
+	return -1;
+      }
+    }
+    return len - zs_.avail_out;
+  }
+
+private:
+  z_stream zs_;
+  string in_;
+  bool eof_;
+};
+
+// BGZF input : a series of independent gzip members (blocks) of at most 64 KB
+// with the compressed block size in the BC extra field. A batch of blocks is
+// read sequentially and the blocks are inflated on num_threads threads.
+class BgzfInput : public BatchInput {
+public:
+  BgzfInput(int fd, unsigned int num_threads) : BatchInput(fd, num_threads) { }
+  const char* format() const { return "bgzf"; }
+
+protected:
+  ssize_t decode_batch() {
+    // read a batch of blocks : 18 byte header including BSIZE, then the rest
+    vector<string> blocks;
+    vector<size_t> out_offsets(1, 0);
+    char header[18];
+    while (blocks.size() < BGZF_BATCH_BLOCKS) {
+      ssize_t n = source_.read_fully(header, sizeof(header));
+      if (n < 0) return -1;
+      if (n == 0) break; // end of input
+      if (n < (ssize_t) sizeof(header) || header[12] != 'B' || header[13] != 'C') {
+	ERROR("bgzf : corrupt block header" << endl);
+	return -1;
+      }
+      size_t block_size = (unsigned char) header[16] + ((unsigned char) header[17] << 8) + 1;
+      if (block_size < sizeof(header) + 8) {
+	ERROR("bgzf : corrupt block size" << endl);
+	return -1;
+      }
+      blocks.push_back( string(header, sizeof(header)));
+      blocks.back().resize( block_size);
+      if (source_.read_fully(&blocks.back()[sizeof(header)], block_size - sizeof(header))
+	  != (ssize_t) (block_size - sizeof(header))) {
+	ERROR("bgzf : truncated block" << endl);
+	return -1;
+      }
+      const unsigned char* isize = reinterpret_cast<const unsigned char*>(&blocks.back()[block_size - 4]);
+      out_offsets.push_back( out_offsets.back() +
+			     (isize[0] | (isize[1] << 8) | (isize[2] << 16) | ((size_t) isize[3] << 24)));
+    }
+    if (blocks.empty()) return 0;
+
+    // inflate the blocks in parallel straight into their place in out_
+    out_.resize( out_offsets.back());
+    vector<char> failed( blocks.size());
+    unsigned int num_threads = std::min<size_t>(num_threads_, blocks.size());
+    parallel_run(num_threads, [&](unsigned int t) {
+      z_stream zs;
+      memset(&zs, 0, sizeof(zs));
+      inflateInit2(&zs, 15 + 16);
+      size_t last = partition_begin(blocks.size(), num_threads, t+1);
+      for (size_t b = partition_begin(blocks.size(), num_threads, t); b < last; ++b) {
+	inflateReset(&zs);
+	zs.next_in = reinterpret_cast<Bytef*>(&blocks[b][0]);
+	zs.avail_in = blocks[b].size();
+	zs.next_out = reinterpret_cast<Bytef*>(&out_[0] + out_offsets[b]);
+	zs.avail_out = out_offsets[b+1] - out_offsets[b];
+	int ret = inflate(&zs, Z_FINISH);
+	failed[b] = (ret != Z_STREAM_END || zs.avail_out != 0);
+      }
+      inflateEnd(&zs);
+    });
+    if (std::find(failed.begin(), failed.end(), 1) != failed.end()) {
+      ERROR("bgzf : corrupt block data" << endl);
+      return -1;
+    }
+    return out_.size();
+  }
+};
+#endif
+
+#ifdef HAVE_ZSTD
+// zstd input : a chunk of input is split into frames and the frames whose
+// content size is recorded in their header are decompressed in parallel.
+// Single frame files (or frames without a content size, or larger than a chunk)
+// are decompressed with the streaming decoder.
+class ZstdInput : public BatchInput {
+public:
+  ZstdInput(int fd, unsigned int num_threads)
+    : BatchInput(fd, num_threads), eof_(false), streaming_(false), in_pos_(0) {
+    stream_ = ZSTD_createDStream();
+    ZSTD_initDStream(stream_);
+  }
+  ~ZstdInput() { ZSTD_freeDStream(stream_); }
+  const char* format() const { return streaming_? "zstd (streaming)" : "zstd"; }
+
+protected:
+  ssize_t decode_batch() {
+    // top up the input chunk
+    if (!eof_ && in_.size() - in_pos_ < ZSTD_BATCH_SIZE) {
+      in_.erase(0, in_pos_);
+      in_pos_ = 0;
+      size_t have = in_.size();
+      in_.resize( ZSTD_BATCH_SIZE);
+      ssize_t n = source_.read_fully(&in_[have], ZSTD_BATCH_SIZE - have);
+      if (n < 0) return -1;
+      in_.resize( have + n);
+      eof_ = (have + n < ZSTD_BATCH_SIZE);
+    }
+    if (in_pos_ == in_.size()) return 0; // end of input
+    if (!streaming_) {
+      ssize_t n = decode_frames();
+      if (n != 0) return n;
+      streaming_ = true; // next frame cannot be done in one piece
+      PRINT(LOG_LVL_2, "zstd : switching to streaming decompression" << endl);
+    }
+    return decode_stream();
+  }
+
+private:
+  // decompress the complete frames of known size in the chunk in parallel
+  // returns 0 if the first frame cannot be decompressed as a whole
+  ssize_t decode_frames() {
+    vector<pair<size_t, size_t> > frames; // (offset, compressed size) in in_
+    vector<size_t> out_offsets(1, 0);
+    size_t pos = in_pos_;
+    while (pos < in_.size()) {
+      size_t frame_size = ZSTD_findFrameCompressedSize(in_.data() + pos, in_.size() - pos);
+      if (ZSTD_isError(frame_size)) break; // incomplete frame
+      unsigned long long content = ZSTD_getFrameContentSize(in_.data() + pos, frame_size);
+      if (content == ZSTD_CONTENTSIZE_UNKNOWN || content == ZSTD_CONTENTSIZE_ERROR) break;
+      frames.push_back( std::make_pair(pos, frame_size));
+      out_offsets.push_back( out_offsets.back() + content);
+      pos += frame_size;
+    }
+    if (frames.empty()) return 0;
+
+    out_.resize( out_offsets.back());
+    vector<char> failed( frames.size());
+    unsigned int num_threads = std::min<size_t>(num_threads_, frames.size());
+    parallel_run(num_threads, [&](unsigned int t) {
+      ZSTD_DCtx* ctx = ZSTD_createDCtx();
+      size_t last = partition_begin(frames.size(), num_threads, t+1);
+      for (size_t f = partition_begin(frames.size(), num_threads, t); f < last; ++f) {
+	size_t n = ZSTD_decompressDCtx(ctx, &out_[0] + out_offsets[f], out_offsets[f+1] - out_offsets[f],
+				       in_.data() + frames[f].first, frames[f].second);
+	failed[f] = (ZSTD_isError(n) || n != out_offsets[f+1] - out_offsets[f]);
+      }
+      ZSTD_freeDCtx(ctx);
+    });
+    if (std::find(failed.begin(), failed.end(), 1) != failed.end()) {
+      ERROR("zstd : corrupt frame" << endl);
+      return -1;
+    }
+    in_pos_ = pos;
+    return out_.size();
+  }
+
+  // streaming decompression of the chunk
+  ssize_t decode_stream() {
+    out_.resize( ZSTD_DStreamOutSize() * 16);
+    ZSTD_inBuffer in = { in_.data(), in_.size(), in_pos_ };
+    ZSTD_outBuffer out = { &out_[0], out_.size(), 0 };
+    while (out.pos == 0 && in.pos < in.size) {
+      size_t ret = ZSTD_decompressStream(stream_, &out, &in);
+      if (ZSTD_isError(ret)) {
+	ERROR("zstd : " << ZSTD_getErrorName(ret) << endl);
+	return -1;
+      }
+    }
+    in_pos_ = in.pos;
+    out_.resize( out.pos);
+    if (out.pos == 0 && eof_) return 0;
+    return out.pos? (ssize_t) out.pos : decode_batch(); // input used up : read more
+  }
+
+  ZSTD_DStream* stream_;
+  bool eof_;
+  bool streaming_;
+  string in_;
+  size_t in_pos_;
+};
+#endif
+
+// Open the network file : sniff the magic bytes and pick the decoder
+std::unique_ptr<InputStream> InputStream::open(int fd, unsigned int num_threads) {
+#ifdef POSIX_FADV_SEQUENTIAL
+  posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+  ByteSource probe(fd);
+  unsigned char magic[18];
+  ssize_t n = probe.read_fully(reinterpret_cast<char*>(magic), sizeof(magic));
+  if (n < 0) n = 0; // the error shows again on the first read
+
+  std::unique_ptr<InputStream> input;
+  bool gzip = (n >= 2 && magic[0] == 0x1f && magic[1] == 0x8b);
+  bool bgzf = (gzip && n >= 14 && (magic[3] & 4) && magic[12] == 'B' && magic[13] == 'C');
+  bool zstd = (n >= 4 && magic[0] == 0x28 && magic[1] == 0xb5 && magic[2] == 0x2f && magic[3] == 0xfd);
+#ifdef HAVE_ZLIB
+  if (bgzf) input.reset( new BgzfInput(fd, num_threads));
+  else if (gzip) input.reset( new GzipInput(fd));
+#else
+  if (gzip || bgzf) {
+    ERROR("gzip input is not supported by this build (zlib missing)" << endl);
+    return input;
+  }
+#endif
+#ifdef HAVE_ZSTD
+  if (zstd) input.reset( new ZstdInput(fd, num_threads));
+#else
+  if (zstd) {
+    ERROR("zstd input is not supported by this build (libzstd missing)" << endl);
+    return input;
+  }
+#endif
+  if (!input) input.reset( new RawInput(fd));
+  input->source_.unread(reinterpret_cast<char*>(magic), n);
+  PRINT(LOG_LVL_2, "Input format : " << input->format() << endl);
+  return input;
+}
@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2012 Chammika Mannakkara
+ *
+ *    InputStream.h - Network file input layer with transparent streaming
+ *                    decompression (gzip, BGZF, zstd)
+ *
+ *    This is a part of simple tool calculate the PageRank
+ *
+ *    This source code is free software; you can redistribute it
+ *    and/or modify it in source code form under the terms of the GNU
+ *    General Public License as published by the Free Software
+ *    Foundation; either version 2 of the License, or (at your option)
+ *    any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+#ifndef PAGERANK_INPUT_STREAM_CLASS
+#define PAGERANK_INPUT_STREAM_CLASS
+
+#include <memory>
+#include <sys/types.h>
+
+#include "types.h"
+
+// ByteSource - unbuffered reader of a file descriptor which can hand back
+// the bytes already consumed to sniff the input format.
+class ByteSource {
+public:
+  ByteSource(int fd) : fd_(fd), pushback_pos_(0), bytes_read_(0) { }
+
+  // read up to len bytes, 0 at end of input, -1 on errors
+  ssize_t read(char* buf, size_t len);
+  // read len bytes unless the input ends first, -1 on errors
+  ssize_t read_fully(char* buf, size_t len);
+  // return bytes to be read again before the rest of the file
+  void unread(const char* buf, size_t len) { pushback_.insert(0, buf, len); pushback_pos_ = 0; }
+  // bytes taken from the file so far (compressed size for compressed inputs)
+  unsigned long long bytes_read() const { return bytes_read_; }
+
+private:
+  int fd_;
+  string pushback_;
+  size_t pushback_pos_;
+  unsigned long long bytes_read_;
+};
+
+// InputStream - (decompressed) text of a network file. The format is chosen by
+// the magic bytes at the start of the file :
+//   1f 8b ... 'B' 'C'  BGZF (blocked gzip)  blocks are inflated in parallel
+//   1f 8b              gzip (any number of members)  streaming inflate
+//   28 b5 2f fd        zstd                 frames of known size are
+//                                           decompressed in parallel
+//   anything else      plain text
+class InputStream {
+public:
+  virtual ~InputStream() { }
+
+  // read up to len bytes of text, 0 at end of input, -1 on errors
+  virtual ssize_t read(char* buf, size_t len) = 0;
+  // name of the input format
+  virtual const char* format() const = 0;
+  // bytes taken from the file so far
+  unsigned long long bytes_read() const { return source_.bytes_read(); }
+
+  // open the network file on fd, decompression runs on up to num_threads threads
+  // returns 0 if the format is not supported by this build
+  static std::unique_ptr<InputStream> open(int fd, unsigned int num_threads);
+
+protected:
+  InputStream(int fd) : source_(fd) { }
+  ByteSource source_;
+};
+
+#endif
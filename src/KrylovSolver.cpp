@@ -0,0 +1,308 @@
+/*
+ * Copyright (c) 2012 Chammika Mannakkara
+ *
+ *    KrylovSolver.cpp - Implementation of the GMRES / BiCGSTAB PageRank solver
+ *
+ *    This is a part of simple tool calculate the PageRank
+ *
+ *    This source code is free software; you can redistribute it
+ *    and/or modify it in source code form under the terms of the GNU
+ *    General Public License as published by the Free Software
+ *    Foundation; either version 2 of the License, or (at your option)
+ *    any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+#include <cmath>
+
+#include "KrylovSolver.h"
+#include "Parallel.h"
+#include "Log.h"
+
+// Vector operations : split over the threads for long vectors only, as each
+// parallel_run() starts the worker threads
+
+// func(first, last) on the parts of [0, n), over at most max_threads threads
+template<typename Func>
+static void for_range(unsigned int max_threads, size_t n, Func func) {
+  unsigned int num_threads = (n >= KRYLOV_PARALLEL_MIN)? max_threads : 1;
+  parallel_run(num_threads, [&](unsigned int t) {
+    func(partition_begin(n, num_threads, t), partition_begin(n, num_threads, t+1));
+  });
+}
+
+// op() of func(first, last) over the parts of [0, n), combined in part order
+template<typename Func, typename Op>
+static double reduce_range(unsigned int max_threads, size_t n, Func func, Op op) {
+  unsigned int num_threads = (n >= KRYLOV_PARALLEL_MIN)? max_threads : 1;
+  vector<double> parts( num_threads);
+  parallel_run(num_threads, [&](unsigned int t) {
+    parts[t] = func(partition_begin(n, num_threads, t), partition_begin(n, num_threads, t+1));
+  });
+  double result = parts[0];
+  for (unsigned int t = 1; t < num_threads; ++t) result = op(result, parts[t]);
+  return result;
+}
+
+template<typename Vec>
+static double dot(unsigned int num_threads, const Vec& a, const Vec& b) {
+  return reduce_range(num_threads, a.size(), [&](size_t first, size_t last) {
+      double sum = 0.0;
+      for (size_t i = first; i < last; ++i) sum += a[i] * b[i];
+      return sum;
+    }, std::plus<double>());
+}
+
+template<typename Vec>
+static double norm_inf(unsigned int num_threads, const Vec& a) {
+  return reduce_range(num_threads, a.size(), [&](size_t first, size_t last) {
+      double norm = 0.0;
+      for (size_t i = first; i < last; ++i) norm = std::max(norm, fabs(a[i]));
+      return norm;
+    }, [](double x, double y) { return std::max(x, y); });
+}
+
+// ctor
+// The diagonal of (I - d P^T) is 1 - d/L(i) for the nodes linking to
+// themselves, and 1 for all the others.
+template<typename Index>
+KrylovSolver<Index>::KrylovSolver(const CompressedGraph<Index>& links, rank_type decay, bool jacobi,
+				  unsigned int num_threads, unsigned int restart)
+  : links_(links), decay_(decay), num_threads_(num_threads), restart_(std::max(restart, 1u)),
+    scaled_(links.num_nodes()),
+    stopped_(false) {
+  if (jacobi) {
+    inv_diag_.resize( links.num_nodes());
+    for_range(num_threads_, links.num_nodes(), [&](size_t first, size_t last) {
+	for (size_t i = first; i < last; ++i) {
+	  const Index* row_begin = &links.links_[0] + links.row_offsets_[i];
+	  const Index* row_end = &links.links_[0] + links.row_offsets_[i+1];
+	  bool self_link = std::binary_search(row_begin, row_end, (Index) i); // rows are sorted
+	  inv_diag_[i] = 1.0 / (1.0 - (self_link? decay * links.out_weight_[i] : 0.0));
+	}
+      });
+  }
+}
+
+// y = (I - d P^T) x : prescaled pull sweep as in the power iteration
+template<typename Index>
+void KrylovSolver<Index>::apply(const Vec& x, Vec& y) {
+  parallel_run(num_threads_, [&](unsigned int t) {
+    Index last = links_.node_partition(num_threads_, t+1);
+    for (Index j = links_.node_partition(num_threads_, t); j < last; ++j) {
+      scaled_[j] = x[j] * links_.out_weight_[j];
+    }
+  });
+  parallel_run(num_threads_, [&](unsigned int t) {
+    Index first = links_.row_partition(num_threads_, t), last = links_.row_partition(num_threads_, t+1);
+    sweep_rows<double, Index>(links_, scaled_.data(), y.data(), first, last, decay_, 0.0); // y = d P^T x
+    for (Index i = first; i < last; ++i) {
+      y[i] = x[i] - y[i];
+    }
+  });
+}
+
+template<typename Index>
+void KrylovSolver<Index>::precondition(const Vec& x, Vec& z) const {
+  for_range(num_threads_, x.size(), [&](size_t first, size_t last) {
+      if (inv_diag_.empty()) std::copy(x.begin() + first, x.begin() + last, z.begin() + first);
+      else for (size_t i = first; i < last; ++i) z[i] = x[i] * inv_diag_[i];
+    });
+}
+
+template<typename Index>
+double KrylovSolver<Index>::residual(const Vec& b, const Vec& x, Vec& r) {
+  apply(x, r);
+  for_range(num_threads_, r.size(), [&](size_t first, size_t last) {
+      for (size_t i = first; i < last; ++i) r[i] = b[i] - r[i];
+    });
+  return norm_inf(num_threads_, r);
+}
+
+template<typename Index>
+unsigned int KrylovSolver<Index>::solve(eMethod method, const vector<rank_type>& b, vector<rank_type>& x,
+					unsigned int max_sweeps, rank_type epsilon) {
+  const size_t N = links_.num_nodes();
+  Vec vb( N), vx( N);
+  for_range(num_threads_, N, [&](size_t first, size_t last) {
+      std::copy(b.begin() + first, b.begin() + last, vb.begin() + first);
+      std::copy(x.begin() + first, x.begin() + last, vx.begin() + first);
+    });
+  residuals_.clear();
+  stopped_ = false;
+  unsigned int sweeps = (method == GMRES)? gmres(vb, vx, max_sweeps, epsilon)
+    : bicgstab(vb, vx, max_sweeps, epsilon);
+  x.assign( vx.begin(), vx.end());
+  return sweeps;
+}
+
+// Restarted GMRES(m), right preconditioned so that the residual it minimizes
+// is the true residual. Arnoldi with modified Gram-Schmidt, the least squares
+// problem is kept triangular with Givens rotations, which also give its
+// residual (2-norm) after each sweep. The true max-norm residual is computed
+// at each restart.
+// Memory : m + 4 vectors of N doubles
+// (with NO_CONVERGENCE_CHECK epsilon is negative and no test passes)
+template<typename Index>
+unsigned int KrylovSolver<Index>::gmres(const Vec& b, Vec& x, unsigned int max_sweeps,
+					rank_type epsilon) {
+  const size_t N = x.size();
+  const unsigned int m = restart_;
+  vector<Vec> V( m + 1); // Krylov basis
+  for (unsigned int k = 0; k <= m; ++k) V[k].resize( N);
+  Vec z( N), w( N), r( N);
+  vector<vector<double> > H( m + 1, vector<double>( m)); // Hessenberg matrix
+  vector<double> cs( m), sn( m), g( m + 1), y( m);
+
+  unsigned int sweeps = 1;
+  double res = residual(b, x, r);
+  residuals_.push_back( res);
+  PRINT(LOG_LVL_2, "GMRES(" << m << ") initial residual " << res << endl);
+  while (res >= epsilon && sweeps < max_sweeps && !stopped_) {
+    double beta = sqrt(dot(num_threads_, r, r));
+    if (beta == 0.0) break;
+    for_range(num_threads_, N, [&](size_t first, size_t last) {
+	for (size_t i = first; i < last; ++i) V[0][i] = r[i] / beta;
+      });
+    std::fill(g.begin(), g.end(), 0.0);
+    g[0] = beta;
+
+    unsigned int k = 0;
+    bool breakdown = false; // exact solution in the Krylov space
+    while (k < m && sweeps < max_sweeps && !breakdown) {
+      precondition(V[k], z);
+      apply(z, w);
+      ++sweeps;
+      for (unsigned int i = 0; i <= k; ++i) { // orthogonalize against the basis
+	double h = H[i][k] = dot(num_threads_, w, V[i]);
+	for_range(num_threads_, N, [&](size_t first, size_t last) {
+	    for (size_t l = first; l < last; ++l) w[l] -= h * V[i][l];
+	  });
+      }
+      double h = H[k+1][k] = sqrt(dot(num_threads_, w, w));
+      breakdown = (h == 0.0);
+      if (!breakdown) {
+	for_range(num_threads_, N, [&](size_t first, size_t last) {
+	    for (size_t l = first; l < last; ++l) V[k+1][l] = w[l] / h;
+	  });
+      }
+      for (unsigned int i = 0; i < k; ++i) { // previous rotations on the new column
+	double temp = cs[i] * H[i][k] + sn[i] * H[i+1][k];
+	H[i+1][k] = -sn[i] * H[i][k] + cs[i] * H[i+1][k];
+	H[i][k] = temp;
+      }
+      double denom = hypot(H[k][k], H[k+1][k]);
+      cs[k] = H[k][k] / denom;
+      sn[k] = H[k+1][k] / denom;
+      H[k][k] = denom;
+      H[k+1][k] = 0.0;
+      g[k+1] = -sn[k] * g[k];
+      g[k] = cs[k] * g[k];
+      ++k;
+
+      double estimate = fabs(g[k]);
+      residuals_.push_back( estimate);
+      PRINT(LOG_LVL_2, "Iteration #" << sweeps << " residual (2-norm) " << estimate << endl);
+      if (estimate < epsilon) break;
+      if (progress_ && !progress_(sweeps, estimate)) {
+	stopped_ = true;
+	break;
+      }
+    }
+
+    for (int i = k - 1; i >= 0; --i) { // y = H^-1 g
+      double sum = g[i];
+      for (unsigned int l = i + 1; l < k; ++l) sum -= H[i][l] * y[l];
+      y[i] = sum / H[i][i];
+    }
+    for_range(num_threads_, N, [&](size_t first, size_t last) { // x += M^-1 V y
+	for (size_t l = first; l < last; ++l) {
+	  double sum = 0.0;
+	  for (unsigned int i = 0; i < k; ++i) sum += y[i] * V[i][l];
+	  w[l] = sum;
+	}
+      });
+    precondition(w, z);
+    for_range(num_threads_, N, [&](size_t first, size_t last) {
+	for (size_t l = first; l < last; ++l) x[l] += z[l];
+      });
+
+    res = residual(b, x, r);
+    ++sweeps;
+    residuals_.push_back( res);
+    PRINT(LOG_LVL_2, "Restart after " << sweeps << " sweeps, residual " << res << endl);
+  }
+  return sweeps;
+}
+
+// Preconditioned BiCGSTAB : two sweeps per iteration, max-norm residual
+// after each iteration. Restarts from the true residual on breakdown.
+// Memory : 9 vectors of N doubles
+template<typename Index>
+unsigned int KrylovSolver<Index>::bicgstab(const Vec& b, Vec& x, unsigned int max_sweeps,
+					   rank_type epsilon) {
+  const size_t N = x.size();
+  Vec r( N), r0( N), p( N), v( N), s( N), t( N), phat( N), shat( N);
+
+  unsigned int sweeps = 1;
+  double res = residual(b, x, r);
+  residuals_.push_back( res);
+  PRINT(LOG_LVL_2, "BiCGSTAB initial residual " << res << endl);
+  bool restart = true;
+  double rho = 1.0, alpha = 1.0, omega = 1.0;
+  while (res >= epsilon && sweeps + 2 <= max_sweeps && !stopped_) {
+    if (restart) { // shadow residual r0 = r, p = v = 0
+      for_range(num_threads_, N, [&](size_t first, size_t last) {
+	  std::copy(r.begin() + first, r.begin() + last, r0.begin() + first);
+	  std::fill(p.begin() + first, p.begin() + last, 0.0);
+	  std::fill(v.begin() + first, v.begin() + last, 0.0);
+	});
+      rho = alpha = omega = 1.0;
+      restart = false;
+    }
+    double rho_new = dot(num_threads_, r0, r);
+    if (rho_new == 0.0 || omega == 0.0) { // breakdown
+      res = residual(b, x, r);
+      ++sweeps;
+      restart = true;
+      continue;
+    }
+    double beta = (rho_new / rho) * (alpha / omega);
+    rho = rho_new;
+    for_range(num_threads_, N, [&](size_t first, size_t last) {
+	for (size_t i = first; i < last; ++i) p[i] = r[i] + beta * (p[i] - omega * v[i]);
+      });
+    precondition(p, phat);
+    apply(phat, v);
+    alpha = rho / dot(num_threads_, r0, v);
+    for_range(num_threads_, N, [&](size_t first, size_t last) {
+	for (size_t i = first; i < last; ++i) s[i] = r[i] - alpha * v[i];
+      });
+    precondition(s, shat);
+    apply(shat, t);
+    double tt = dot(num_threads_, t, t);
+    omega = (tt > 0.0)? dot(num_threads_, t, s) / tt : 0.0;
+    for_range(num_threads_, N, [&](size_t first, size_t last) {
+	for (size_t i = first; i < last; ++i) {
+	  x[i] += alpha * phat[i] + omega * shat[i];
+	  r[i] = s[i] - omega * t[i];
+	}
+      });
+    sweeps += 2;
+    res = norm_inf(num_threads_, r);
+    residuals_.push_back( res);
+    PRINT(LOG_LVL_2, "Iteration #" << sweeps << " residual " << res << endl);
+    stopped_ = progress_ && !progress_(sweeps, res);
+  }
+  return sweeps;
+}
+
+template class KrylovSolver<unsigned int>;
+template class KrylovSolver<unsigned long long>;
@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2012 Chammika Mannakkara
+ *
+ *    KrylovSolver.h - PageRank as a sparse linear system solved with
+ *                     restarted GMRES or BiCGSTAB
+ *
+ *    This is a part of simple tool calculate the PageRank
+ *
+ *    This source code is free software; you can redistribute it
+ *    and/or modify it in source code form under the terms of the GNU
+ *    General Public License as published by the Free Software
+ *    Foundation; either version 2 of the License, or (at your option)
+ *    any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+#ifndef PAGERANK_KRYLOV_SOLVER
+#define PAGERANK_KRYLOV_SOLVER
+
+#include "types.h"
+#include "CompressedGraph.h"
+#include "SweepKernels.h"
+#include "defaults.h"
+
+// KrylovSolver class - solves (I - d P^T) x = b, P^T being the transposed link
+// structure with the transfer factors 1/L (the operator of the power
+// iteration). With b = (1-d)/N the solution is the PageRank vector, and the
+// residual b - (I - d P^T) x is exactly the step the power iteration would
+// take from x, so the max-norm residual is tested against the same epsilon.
+// Each application of the operator is one sweep over the links (pull sweep
+// kernels of SweepKernels.h). Krylov methods converge much faster than the
+// power iteration's rate d for decay factors close to 1.
+template<typename Index>
+class KrylovSolver {
+
+public:
+  typedef enum { GMRES, BICGSTAB } eMethod;
+
+  // jacobi : precondition with the diagonal of (I - d P^T), the sweeps and
+  // the long vector operations run on num_threads threads
+  KrylovSolver(const CompressedGraph<Index>& links, rank_type decay, bool jacobi,
+	       unsigned int num_threads, unsigned int restart=GMRES_RESTART); // ctor
+
+  // solve for x starting from the guess in x, using at most max_sweeps
+  // applications of the operator, until max |residual| < epsilon (or for
+  // max_sweeps sweeps with NO_CONVERGENCE_CHECK). Returns the sweeps used.
+  unsigned int solve(eMethod method, const vector<rank_type>& b, vector<rank_type>& x,
+		     unsigned int max_sweeps, rank_type epsilon);
+
+  // called after each sweep with the residual : returning false stops the
+  // solver (GMRES updates x from the sweeps of the cycle first)
+  void set_progress(const ProgressCallback& progress) { progress_ = progress; }
+
+  // residual after each sweep : GMRES - estimated 2-norm (true max-norm at
+  // restarts), BiCGSTAB - max-norm
+  const vector<double>& residual_history() const { return residuals_; }
+
+private:
+  typedef numa_vector<double> Vec;
+
+  const CompressedGraph<Index>& links_;
+  rank_type decay_;
+  unsigned int num_threads_;
+  unsigned int restart_;
+  Vec inv_diag_;     // Jacobi preconditioner (empty : none)
+  Vec scaled_;       // working space of apply()
+  vector<double> residuals_;
+  ProgressCallback progress_;
+  bool stopped_; // by progress_
+
+  // y = (I - d P^T) x
+  void apply(const Vec& x, Vec& y);
+  // z = M^-1 x
+  void precondition(const Vec& x, Vec& z) const;
+  // r = b - A x, returns max |r|
+  double residual(const Vec& b, const Vec& x, Vec& r);
+
+  unsigned int gmres(const Vec& b, Vec& x, unsigned int max_sweeps, rank_type epsilon);
+  unsigned int bicgstab(const Vec& b, Vec& x, unsigned int max_sweeps, rank_type epsilon);
+
+  KrylovSolver( const KrylovSolver&); // copy ctor -not allowed
+  KrylovSolver& operator=( const KrylovSolver&); // assignment operator -not allowed
+};
+
+#endif
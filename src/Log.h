@@ -30,6 +30,7 @@ using std::cerr;
 
 struct Log { // class Log public:
   static unsigned char level_;
+  static std::ostream* out_; // PRINT output : std::cout unless redirected by an embedder
 };
 
 // Simple macros loging : DEBUG, PRINT and ERROR
@@ -44,7 +45,7 @@ struct Log { // class Log public:
 #define DEBUG(str) 
 #endif
 
-#define PRINT(lvl, str) if (Log::level_ >= lvl) std::cout << str ;
+#define PRINT(lvl, str) if (Log::level_ >= lvl) *Log::out_ << str ;
 
 #define LOG_LVL_1       1
 #define LOG_LVL_2       2
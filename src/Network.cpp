@@ -22,14 +22,23 @@
  *    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
  */
 #include <cassert>
+#include <cctype>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+
 #include "Network.h"
+#include "Parallel.h"
 #include "Log.h"
 
 
 // ctor
 // growth_rate is the only parameter for constructor if not provided
 // DEFAULT_GROWTH_RATE is used. 
-Network::Network(unsigned int growth_rate) : growth_rate_(growth_rate) {
+Network::Network(unsigned int growth_rate)
+  : adj_list_(ArenaAllocator<neighbor_set_type>(&adj_arena_)),
+    back_node_set_(ArenaAllocator<back_neighbor_set_type>(&back_arena_)), back_sets_released_(false),
+    growth_rate_(growth_rate) {
 
   assert(growth_rate && "Growth Rate of the network cannot be zero!");
 
@@ -48,6 +57,14 @@ Network::Network(unsigned int growth_rate) : growth_rate_(growth_rate) {
 // Returns the unique ID for a string URL
 node_id_type Network::get_node_id( const string& url) {
   node_id_type id;
+  if (url_dictionary_) { // fingerprint URL mode
+    if (!url_dictionary_->find(url, id)) {
+      id = num_nodes_++ ;
+      url_dictionary_->insert(url, id);
+      DEBUG("New node added to network : " << Node(id, url) << endl);
+    }
+    return id;
+  }
   in_citer iter = url_2_node_.find( url);
   if (iter == url_2_node_.end() ) { // new url -> issue a new ID and add it to in/out maps
     id = num_nodes_++ ;
@@ -64,6 +81,52 @@ node_id_type Network::get_node_id( const string& url) {
   return id;
 }
 
+bool Network::find_node_id(std::string_view url, node_id_type& id) const {
+  if (url_dictionary_) {
+    return url_dictionary_->find(url, id);
+  }
+  in_citer iter = url_2_node_.find( string( url));
+  if (iter == url_2_node_.end()) {
+    return false;
+  }
+  id = iter->second.id();
+  return true;
+}
+
+// Switch to the fingerprint URL mode, before any node is added
+bool Network::set_url_dictionary(const string& path) {
+  assert(!num_nodes_ && "URL dictionary must be set before adding nodes");
+  url_dictionary_.reset( new UrlDictionary());
+  if (!url_dictionary_->create( path)) {
+    url_dictionary_.reset();
+    return false;
+  }
+  PRINT(LOG_LVL_2, "URL fingerprint mode : URLs kept in " << path << endl);
+  return true;
+}
+
+// The sets are never destroyed one by one (ArenaAllocator) : dropping the
+// vector frees it alone, and the arena returns all the tree nodes.
+void Network::release_back_node_sets() {
+  arena_vector<back_neighbor_set_type>( back_node_set_.get_allocator()).swap(back_node_set_);
+  back_arena_.release();
+  back_sets_released_ = true;
+}
+
+std::string_view Network::url(node_id_type id) const {
+  if (url_dictionary_) {
+    return url_dictionary_->url( id);
+  }
+  return id_2_node_.find( id)->second.url();
+}
+
+// Outbound neighbors of a node. Nodes only seen as link destinations may lie
+// beyond the (lazily grown) adj_list_, they have no outbound links.
+const neighbor_set_type& Network::neighbors(node_id_type id) const {
+  static const neighbor_set_type no_neighbors;
+  return (id < adj_list_.size())? adj_list_[id] : no_neighbors;
+}
+
 // Add an edge src_url ---> dst_url in the Network
 // This method is called while reading the network file of the form:
 // <src_url> <dst_url>
@@ -81,7 +144,7 @@ void Network::add_edge(const string& src_url, const string& dst_url) {
   node_id_type dst_id = get_node_id( dst_url);
 
   if (src_id == dst_id ) { // self-loop
-    PRINT(LOG_LVL_3, "Ignoring self-loop for node " << (url_2_node_.find( src_url))->second << endl);
+    PRINT(LOG_LVL_3, "Ignoring self-loop for node " << Node(src_id, src_url) << endl);
     return;
   }
 
@@ -99,12 +162,15 @@ void Network::add_edge(const string& src_url, const string& dst_url) {
   }
   else { // duplicate edge - no need to add to back_node_set_, it's already added
     PRINT(LOG_LVL_3, "Ignoring duplicate edge for nodes " 
-	           << (url_2_node_.find( src_url))->second << " -> " 
-	           << (url_2_node_.find( dst_url))->second << endl);
+	           << Node(src_id, src_url) << " -> " 
+	           << Node(dst_id, dst_url) << endl);
     return;
   }
 
   // insert edge to back_node_set_ (ie. add 'src_id' to the the back_node_set_ of 'dst_id')
+  if (back_sets_released_) {
+    return;
+  }
   if (back_node_set_.size() <= dst_id) {
     DEBUG("Resizing back node set vector<> size = " << dst_id + growth_rate_ << endl);
     back_node_set_.resize(dst_id + growth_rate_) ; // accomodate dst_id position + additional
@@ -115,13 +181,278 @@ void Network::add_edge(const string& src_url, const string& dst_url) {
   
 }
 
+// Position of the first appearance of a URL token in the input, encoded as
+// (chunk index << CHUNK_POS_SHIFT) | (token index within the chunk), chunk 0
+// being the token carried from the previous text (if any) and chunk t+1 the
+// text of thread t. Chunks are contiguous and in input order, so ordering URLs
+// by this position gives exactly the order in which the sequential reader
+// issues IDs.
+typedef unsigned long long token_pos_type;
+#define CHUNK_POS_SHIFT 40
+
+// URL -> ID hash used by add_edges_parallel(). The keys point into the input
+// text (no string copies) and the table is split into shards with their own
+// lock, so that parser threads rarely contend on the same shard.
+struct UrlEntry {
+  token_pos_type first_pos; // first appearance of the URL in the input
+  node_id_type id;          // ID issued to the URL (valid after ID assignment)
+};
+typedef std::unordered_map<std::string_view, UrlEntry> url_shard_type;
+
+struct ShardedUrlTable {
+  ShardedUrlTable(unsigned int num_shards) : shards_(num_shards), locks_(num_shards) { }
+
+  unsigned int shard_of(std::string_view url) const {
+    return std::hash<std::string_view>()(url) % shards_.size();
+  }
+  const UrlEntry& find(std::string_view url) const { // URL must be in the table
+    return shards_[shard_of( url)].find( url)->second;
+  }
+
+  vector<url_shard_type> shards_;
+  vector<std::mutex> locks_;
+};
+
+// Split "<src_url> <dst_url>" text into whitespace separated tokens, appended
+// to tokens. As with operator>>, line breaks are only whitespace : tokens
+// (2k, 2k+1) of the whole input form an edge, so a text with an odd number of
+// tokens ends with the source URL of an edge completed by the text after it.
+void Network::tokenize(const char* begin, const char* end, vector<std::string_view>& tokens) {
+  const char* p = begin;
+  while (p != end) {
+    while (p != end && isspace(static_cast<unsigned char>(*p))) ++p;
+    const char* token = p;
+    while (p != end && !isspace(static_cast<unsigned char>(*p))) ++p;
+    if (p != token) {
+      tokens.push_back( std::string_view(token, p - token));
+    }
+  }
+}
+
+void Network::add_edges_parallel(const char* text, size_t length, unsigned int num_threads) {
+  string unpaired; // an incomplete edge at the end is dropped, as by operator>>
+  add_edges_parallel(text, length, num_threads, unpaired);
+}
+
+// Concurrent network build from an edge list held in memory. Produces exactly
+// the same Network (IDs, adjacency, back links) as reading the same text with
+// operator>>, independent of the number of threads and their scheduling. The
+// tokens are paired over the whole text, across the chunks of the threads,
+// and across calls through unpaired.
+//
+// Algorithm :
+// 1. Split the text into num_threads chunks at line boundaries. Each thread
+//    tokenizes its chunk into a per-thread token buffer. The token offsets of
+//    the chunks give the pairing, and an unpaired last token is set aside.
+//    Each thread then de-duplicates the URLs of its chunk locally and merges
+//    them into the sharded URL table, keeping the earliest position of every
+//    URL (one lock per shard and per thread).
+// 2. Sort the distinct URLs by first position and issue IDs in that order,
+//    then fill the URL -> Node and ID -> Node maps (two threads).
+// 3. Each thread translates its edge buffer to IDs and buckets the edges by
+//    the thread owning the src ID (forward links) and the dst ID (back links).
+// 4. Each owner thread merges the buckets of all threads into its own range of
+//    adj_list_ and back_node_set_ : no two threads touch the same map<>/set<>
+void Network::add_edges_parallel(const char* text, size_t length, unsigned int num_threads,
+				 string& unpaired) {
+
+  assert(num_threads && "Number of threads cannot be zero!");
+  assert(num_threads < (1u << (64 - CHUNK_POS_SHIFT)) - 1 && "Too many threads for position encoding");
+
+  // 1. chunk boundaries - each chunk starts at the beginning of a line
+  vector<const char*> chunk_begin(num_threads + 1);
+  chunk_begin[0] = text;
+  chunk_begin[num_threads] = text + length;
+  for (unsigned int t = 1; t < num_threads; ++t) {
+    const char* p = std::max(chunk_begin[t-1], text + partition_begin(length, num_threads, t));
+    while (p != text + length && *p != '\n') ++p;
+    chunk_begin[t] = (p == text + length)? p : p + 1;
+  }
+
+  ShardedUrlTable urls( num_threads * 8);
+  vector<vector<std::string_view> > tokens( num_threads); // per-thread token buffers
+  parallel_run(num_threads, [&](unsigned int t) {
+    tokenize(chunk_begin[t], chunk_begin[t+1], tokens[t]);
+  });
+
+  // pairing : the carried token (if any) is token 0 of the text, offsets[t]
+  // is the index of the first token of chunk t, and a token at an even index
+  // is the source URL of an edge ending at the next token
+  const string carried( unpaired);
+  unpaired.clear();
+  size_t count = carried.size()? 1 : 0;
+  unsigned int last = num_threads; // last chunk with tokens
+  for (unsigned int t = 0; t < num_threads; ++t) {
+    count += tokens[t].size();
+    if (!tokens[t].empty()) last = t;
+  }
+  if (count % 2) { // odd number of tokens : the last one goes to the next text
+    if (last == num_threads) { // only the carried token
+      unpaired = carried;
+      return;
+    }
+    unpaired.assign( tokens[last].back().data(), tokens[last].back().size());
+    tokens[last].pop_back();
+  }
+  vector<size_t> offsets( num_threads + 1);
+  offsets[0] = carried.size()? 1 : 0;
+  for (unsigned int t = 0; t < num_threads; ++t) {
+    offsets[t+1] = offsets[t] + tokens[t].size();
+  }
+  vector<std::string_view> next_first( num_threads); // first token after chunk t
+  std::string_view first; // first token of the text (after the carried one)
+  for (unsigned int t = num_threads; t-- > 0; ) {
+    next_first[t] = first;
+    if (!tokens[t].empty()) first = tokens[t].front();
+  }
+  if (carried.size()) {
+    UrlEntry entry = { 0, 0 };
+    urls.shards_[urls.shard_of( carried)].emplace( std::string_view( carried), entry);
+  }
+
+  parallel_run(num_threads, [&](unsigned int t) {
+    // first position of each URL within this chunk
+    std::unordered_map<std::string_view, token_pos_type> local;
+    for (size_t i = 0; i < tokens[t].size(); ++i) {
+      local.emplace(tokens[t][i], (static_cast<token_pos_type>(t + 1) << CHUNK_POS_SHIFT) | i);
+    }
+    vector<vector<pair<std::string_view, token_pos_type> > > by_shard( urls.shards_.size());
+    for (auto iter = local.begin(); iter != local.end(); ++iter) {
+      by_shard[urls.shard_of( iter->first)].push_back( *iter);
+    }
+    for (unsigned int s = 0; s < by_shard.size(); ++s) {
+      if (by_shard[s].empty()) continue;
+      std::lock_guard<std::mutex> lock( urls.locks_[s]);
+      url_shard_type& shard = urls.shards_[s];
+      for (size_t i = 0; i < by_shard[s].size(); ++i) {
+	UrlEntry entry = { by_shard[s][i].second, 0 };
+	auto res = shard.emplace( by_shard[s][i].first, entry);
+	if (!res.second && entry.first_pos < res.first->second.first_pos) { // seen earlier
+	  res.first->second.first_pos = entry.first_pos;
+	}
+      }
+    }
+  });
+
+  // 2. issue IDs in order of first appearance
+  vector<pair<token_pos_type, url_shard_type::value_type*> > order;
+  for (unsigned int s = 0; s < urls.shards_.size(); ++s) {
+    url_shard_type& shard = urls.shards_[s];
+    for (auto iter = shard.begin(); iter != shard.end(); ++iter) {
+      order.push_back( std::make_pair(iter->second.first_pos, &*iter));
+    }
+  }
+  sort(order.begin(), order.end());
+
+  vector<pair<node_id_type, string> > new_nodes; // nodes not yet in the network
+  if (!url_dictionary_) {
+    new_nodes.reserve( order.size());
+  }
+  node_id_type first_new = num_nodes_;
+  for (size_t i = 0; i < order.size(); ++i) {
+    std::string_view url = order[i].second->first;
+    node_id_type& id = order[i].second->second.id;
+    if (find_node_id(url, id)) { // network may already hold some nodes
+      continue;
+    }
+    id = num_nodes_++;
+    if (url_dictionary_) { // fingerprint URL mode : the side file is written in ID order
+      url_dictionary_->insert(url, id);
+    }
+    else {
+      new_nodes.push_back( std::make_pair(id, string( url)));
+    }
+  }
+  vector<pair<token_pos_type, url_shard_type::value_type*> >().swap(order);
+
+  parallel_run(std::min(num_threads, 2u), [&](unsigned int t) {
+    if (t == 0 || num_threads == 1) { // URL -> ID map
+      for (size_t i = 0; i < new_nodes.size(); ++i) {
+	url_2_node_.insert( url_node_pair( new_nodes[i].second, Node(new_nodes[i].first, new_nodes[i].second)));
+      }
+    }
+    if (t == 1 || num_threads == 1) { // ID -> URL map, IDs are issued in increasing order
+      for (size_t i = 0; i < new_nodes.size(); ++i) {
+	id_2_node_.insert( id_2_node_.end(), 
+			   id_node_pair( new_nodes[i].first, Node(new_nodes[i].first, new_nodes[i].second)));
+      }
+    }
+  });
+  PRINT(LOG_LVL_2, num_nodes_ - first_new << " Nodes added by " << num_threads << " thread(s)." << endl);
+  vector<pair<node_id_type, string> >().swap(new_nodes);
+
+  // 3. translate edge buffers to IDs and bucket them by owner thread
+  typedef vector<pair<node_id_type, node_id_type> > edge_bucket_type;
+  vector<vector<edge_bucket_type> > out_buckets( num_threads, vector<edge_bucket_type>( num_threads));
+  vector<vector<edge_bucket_type> > in_buckets( num_threads, vector<edge_bucket_type>( num_threads));
+  vector<edge_count_type> self_loops( num_threads);
+  node_id_type ids_per_owner = (num_nodes_ + num_threads - 1) / num_threads;
+
+  parallel_run(num_threads, [&](unsigned int t) {
+    auto add = [&](std::string_view src, std::string_view dst) {
+      node_id_type src_id = urls.find( src).id;
+      node_id_type dst_id = urls.find( dst).id;
+      if (src_id == dst_id) { // self-loop
+	++self_loops[t];
+	return;
+      }
+      out_buckets[t][src_id / ids_per_owner].push_back( std::make_pair(src_id, dst_id));
+      if (!back_sets_released_) {
+	in_buckets[t][dst_id / ids_per_owner].push_back( std::make_pair(src_id, dst_id));
+      }
+    };
+    const vector<std::string_view>& tok = tokens[t];
+    if (t == 0 && carried.size()) { // edges in input order within the buckets of t
+      add(carried, first);
+    }
+    for (size_t i = offsets[t] % 2; i < tok.size(); i += 2) { // edges starting in this chunk
+      add(tok[i], (i + 1 < tok.size())? tok[i+1] : next_first[t]);
+    }
+    vector<std::string_view>().swap(tokens[t]);
+  });
+
+  // 4. merge into the adjacency list / back node sets owned by each thread
+  if (adj_list_.size() < num_nodes_) {
+    adj_list_.resize( num_nodes_ + growth_rate_);
+  }
+  if (back_node_set_.size() < num_nodes_ && !back_sets_released_) {
+    back_node_set_.resize( num_nodes_ + growth_rate_);
+  }
+  vector<edge_count_type> edges_added( num_threads);
+
+  parallel_run(num_threads, [&](unsigned int o) {
+    for (unsigned int t = 0; t < num_threads; ++t) { // in input order
+      const edge_bucket_type& out = out_buckets[t][o];
+      for (size_t i = 0; i < out.size(); ++i) {
+	attr_type& edge = adj_list_[out[i].first][out[i].second];
+	if (edge == 0.0) { // if the edge is not inserted before
+	  edge = 1.0;
+	  ++edges_added[o];
+	}
+      }
+      edge_bucket_type().swap(out_buckets[t][o]);
+
+      const edge_bucket_type& in = in_buckets[t][o];
+      for (size_t i = 0; i < in.size(); ++i) {
+	back_node_set_[in[i].second].insert( in[i].first);
+      }
+      edge_bucket_type().swap(in_buckets[t][o]);
+    }
+  });
+
+  edge_count_type total_added = accumulate(edges_added.begin(), edges_added.end(), 0ull);
+  edge_count_type total_loops = accumulate(self_loops.begin(), self_loops.end(), 0ull);
+  num_edges_ += total_added;
+  PRINT(LOG_LVL_2, total_added << " Edges added, " << total_loops << " self-loop(s) ignored." << endl);
+}
+
 // Read the network from an input stream of format:
 // <src_url> <dst_url>
 // <src_url> <dst_url>
 // ..
 istream& operator>>(istream& is, Network& net) {
   string src, dst;
-  int edges = 0;
+  edge_count_type edges = 0;
 
   while (is >> src >> dst) {
     net.add_edge( src, dst) ; 
@@ -137,14 +468,19 @@ istream& operator>>(istream& is, Network& net) {
 ostream& operator<< (ostream &os, const Network &net) {
   os << "Network" << endl;
   os << "Nodes : [ID]URL" << endl;
+  if (net.url_dictionary_) { // no URL -> Node map : in ID order
+    for (node_id_type i=0; i < net.num_nodes_; ++i) {
+      os << net.node( i) << endl;
+    }
+  }
   for(in_citer iter = net.url_2_node_.begin(); iter != net.url_2_node_.end(); ++iter) {
-    cout << iter->second << endl;
+    os << iter->second << endl;
   }
   
   os << "Edges : " << endl;
-  for (unsigned int i=0; i < net.num_nodes_; ++i) { // list edges for each node
+  for (node_id_type i=0; i < net.num_nodes_; ++i) { // list edges for each node
     os << i << "\t: " ;
-    const neighbor_set_type& neighbors = net.adj_list_[i];
+    const neighbor_set_type& neighbors = net.neighbors( i);
     for(attr_citer iter = neighbors.begin(); iter != neighbors.end(); ++iter) {
       os << iter->first << " ";
     }
@@ -24,7 +24,12 @@
 #ifndef PAGERANK_NETWORK_CLASS
 #define PAGERANK_NETWORK_CLASS
 
+#include <memory>
+#include <string_view>
+
+#include "Arena.h"
 #include "Node.h"
+#include "UrlDictionary.h"
 #include "defaults.h"
 
 // Network Class - represents a interconnections of Node objects in a directed
@@ -41,35 +46,67 @@ public:
   Network(unsigned int growth_rate=DEFAULT_GROWTH_RATE); // default ctor
   // ~Network(); // dtor - default is OK
 
+  // Fingerprint URL mode : only URL fingerprints are kept in memory, the URL
+  // strings go to the side file at path (UrlDictionary). To be set before the
+  // first node is added, false if the side file can't be created.
+  bool set_url_dictionary(const string& path);
+
   // Network Building :
+  node_id_type add_node(const string& url) { return get_node_id( url); } // add a (possibly unlinked) node
   void add_edge(const string& src_url, const string& dst_url); // add an edge to network
+  // concurrent build from an in-memory edge list text ("<src_url> <dst_url>" lines)
+  void add_edges_parallel(const char* text, size_t length, unsigned int num_threads);
+  // as above, for a text continued by the next call : unpaired is the source
+  // URL of an incomplete edge at the end of the previous text (empty : none),
+  // and receives the one at the end of this text
+  void add_edges_parallel(const char* text, size_t length, unsigned int num_threads,
+			  string& unpaired);
 
   // I/O :
+  // split edge list text into URL tokens (views into the text)
+  static void tokenize(const char* begin, const char* end, vector<std::string_view>& tokens);
   friend ostream& operator<< (ostream &os, const Network &net);
   friend istream& operator>>(istream& is, Network& net);
 
   // Reference
-  unsigned int num_nodes() const { return num_nodes_ ; }
-  unsigned int num_edges() const { return num_edges_ ; }
+  node_id_type num_nodes() const { return num_nodes_ ; }
+  edge_count_type num_edges() const { return num_edges_ ; }
+  // URL of a node, and the node as [ID]URL. In fingerprint URL mode the side
+  // file is mapped on the first call : no node can be added after it.
+  std::string_view url(node_id_type id) const;
+  Node node(node_id_type id) const { return Node(id, string( url( id))); }
+  // URL <-> Node maps, empty in fingerprint URL mode
   const map<string, Node>& get_url_2_node_map() const { return url_2_node_ ; }
   const map<node_id_type, Node>& get_id_2_node_map() const { return id_2_node_; }
+  const neighbor_set_type& neighbors(node_id_type id) const; // outbound links of a node
+  // ID of a known URL, false if the URL is new
+  bool find_node_id(std::string_view url, node_id_type& id) const;
   
 protected:
   // Given a string representation of Node (here URL) this return the unique ID
   // used by Network to refer to the Node.
   node_id_type get_node_id( const string& src_url);
+  // drop back_node_set_ and free its arena at once (O(1) in the edges).
+  // Edges added afterwards are no longer recorded in back_node_set_.
+  void release_back_node_sets();
+
+  node_id_type num_nodes_; // Number of nodes in the network
+  edge_count_type num_edges_; // Number of edges in the network
 
-  unsigned int num_nodes_; // Number of nodes in the network
-  unsigned int num_edges_; // Number of edges in the network
+  // Tree nodes of the two link sets below, one arena each : no per edge
+  // malloc() / free(), back_node_set_ can be released on its own.
+  Arena adj_arena_;
+  Arena back_arena_;
 
   // For each node on the network adjacency list keeps a map<> of 
   // outbound nodes and their attributes attached the edges
-  vector<neighbor_set_type> adj_list_; 
+  arena_vector<neighbor_set_type> adj_list_; 
 
   // This keeps a set<> of nodes pointing to each node. Since adj_list_
   // keep track of the attributes attached to the edge, this back_nodes
   // only keeps the set<> of nodes to avoid duplication of information
-  vector<back_neighbor_set_type> back_node_set_; 
+  arena_vector<back_neighbor_set_type> back_node_set_; 
+  bool back_sets_released_; // back_node_set_ no longer kept up to date
 
   // Growth rate defines at which rate the above two vector<>s are grown
   // to accomodate the network being read into memory. Need to be depend on
@@ -84,6 +121,8 @@ protected:
   // In this case Node information is just URL data
   map<string, Node> url_2_node_; // URL -> ID (in) map
   map<node_id_type, Node> id_2_node_; // ID -> URL (out) map
+  // fingerprint URL mode : replaces both maps (null otherwise)
+  std::unique_ptr<UrlDictionary> url_dictionary_;
 
 private:
   Network( const Network&); // copy ctor -not allowed yet
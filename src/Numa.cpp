@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2012 Chammika Mannakkara
+ *
+ *    Numa.cpp - Implementation of the NUMA-aware placement helpers
+ *
+ *    This is a part of simple tool calculate the PageRank
+ *
+ *    This source code is free software; you can redistribute it
+ *    and/or modify it in source code form under the terms of the GNU
+ *    General Public License as published by the Free Software
+ *    Foundation; either version 2 of the License, or (at your option)
+ *    any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sched.h>
+#include <sys/mman.h>
+
+#include "Numa.h"
+
+// CPUs this process may run on, grouped by NUMA node (one group if the
+// topology is not available in sysfs)
+static const vector<vector<int> >& cpus_by_node() {
+  static const vector<vector<int> > nodes = [] {
+    vector<vector<int> > nodes;
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+      return nodes;
+    }
+    for (unsigned int node = 0; ; ++node) {
+      char path[64];
+      snprintf(path, sizeof(path), "/sys/devices/system/node/node%u/cpulist", node);
+      std::ifstream in( path);
+      string list;
+      if (!in || !std::getline(in, list)) break;
+      vector<int> cpus;
+      for (const char* p = list.c_str(); *p; ) { // "0-3,8-11"
+	char* end;
+	long first = strtol(p, &end, 10), last = first;
+	if (end == p) break;
+	if (*end == '-') last = strtol(end + 1, &end, 10);
+	for (long cpu = first; cpu <= last; ++cpu) {
+	  if (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed)) cpus.push_back( cpu);
+	}
+	p = (*end == ',')? end + 1 : end;
+      }
+      if (!cpus.empty()) nodes.push_back( cpus);
+    }
+    if (nodes.empty()) { // no sysfs topology : all allowed CPUs on one node
+      nodes.resize( 1);
+      for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+	if (CPU_ISSET(cpu, &allowed)) nodes[0].push_back( cpu);
+      }
+    }
+    return nodes;
+  }();
+  return nodes;
+}
+
+unsigned int Numa::num_nodes() {
+  return cpus_by_node().size();
+}
+
+bool Numa::pin_thread(unsigned int t, unsigned int num_threads) {
+  const vector<vector<int> >& nodes = cpus_by_node();
+  if (nodes.empty() || !num_threads) return false;
+  // worker t belongs to node t * nodes / threads, and takes the next core there
+  size_t node = (size_t) t * nodes.size() / num_threads;
+  size_t first = (node * num_threads + nodes.size() - 1) / nodes.size(); // first worker of node
+  const vector<int>& cpus = nodes[node];
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpus[(t - first) % cpus.size()], &set);
+  return sched_setaffinity(0, sizeof(set), &set) == 0;
+}
+
+SavedAffinity::SavedAffinity(bool save) : saved_(false) {
+  CPU_ZERO(&set_);
+  saved_ = save && sched_getaffinity(0, sizeof(set_), &set_) == 0;
+}
+
+SavedAffinity::~SavedAffinity() {
+  if (saved_) {
+    sched_setaffinity(0, sizeof(set_), &set_);
+  }
+}
+
+void* Numa::allocate(size_t bytes) {
+  if (bytes < LARGE_ALLOCATION) {
+    return ::operator new( bytes);
+  }
+  void* p = mmap(0, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (p == MAP_FAILED) {
+    throw std::bad_alloc();
+  }
+#ifdef MADV_HUGEPAGE
+  if (enabled_) {
+    madvise(p, bytes, MADV_HUGEPAGE); // a hint only, no huge pages is fine
+  }
+#endif
+  return p;
+}
+
+void Numa::deallocate(void* p, size_t bytes) {
+  if (bytes < LARGE_ALLOCATION) {
+    ::operator delete( p);
+  }
+  else {
+    munmap(p, bytes);
+  }
+}
@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2012 Chammika Mannakkara
+ *
+ *    Numa.h - NUMA-aware placement of the solver arrays : thread pinning,
+ *             first-touch partitioning and huge-page backed allocations
+ *
+ *    This is a part of simple tool calculate the PageRank
+ *
+ *    This source code is free software; you can redistribute it
+ *    and/or modify it in source code form under the terms of the GNU
+ *    General Public License as published by the Free Software
+ *    Foundation; either version 2 of the License, or (at your option)
+ *    any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+#ifndef PAGERANK_NUMA
+#define PAGERANK_NUMA
+
+#include <cstddef>
+#include <new>
+#include <sched.h>
+#include <utility>
+
+#include "types.h"
+
+// Linux places a page on the NUMA node of the thread that first writes to it.
+// In NUMA mode (--numa) the solver arrays are allocated untouched and each
+// worker thread, pinned to a core, writes its own partition first, so that the
+// sweep of a partition mostly reads memory local to its socket.
+struct Numa { // class Numa public:
+  // NUMA mode on (--numa)
+  static bool enabled_;
+
+  // pin worker t of num_threads to a core : workers are spread over the
+  // NUMA nodes in contiguous groups (0..k-1 on the first node, ...)
+  // returns false if the affinity couldn't be set
+  static bool pin_thread(unsigned int t, unsigned int num_threads);
+  // number of NUMA nodes with CPUs
+  static unsigned int num_nodes();
+
+  // large (>= LARGE_ALLOCATION bytes) allocations are mmap()'ed, and backed by
+  // transparent huge pages in NUMA mode
+  static void* allocate(size_t bytes);
+  static void deallocate(void* p, size_t bytes);
+  static const size_t LARGE_ALLOCATION = 2 << 20;
+};
+
+// SavedAffinity - CPU affinity of the calling thread, restored by the dtor.
+// parallel_run() pins its caller as worker 0 in NUMA mode : the threads the
+// caller creates later (pipeline stages, diagnostics, jobs) must not inherit
+// that single core.
+class SavedAffinity {
+
+public:
+  explicit SavedAffinity(bool save=true); // ctor - saves the affinity if save
+  ~SavedAffinity(); // dtor - restores it
+
+private:
+  cpu_set_t set_;
+  bool saved_;
+
+  SavedAffinity( const SavedAffinity&); // copy ctor -not allowed
+  SavedAffinity& operator=( const SavedAffinity&); // assignment operator -not allowed
+};
+
+// NumaAllocator - allocator of the solver arrays. Memory comes from
+// Numa::allocate() and elements are default-initialized: resize() of a vector
+// of numbers leaves the new elements UNinitialized, so that they can be first
+// touched by their owner thread.
+template<typename T>
+struct NumaAllocator {
+  typedef T value_type;
+
+  NumaAllocator() { }
+  template<typename U> NumaAllocator(const NumaAllocator<U>&) { }
+
+  T* allocate(size_t n) { return static_cast<T*>(Numa::allocate(n * sizeof(T))); }
+  void deallocate(T* p, size_t n) { Numa::deallocate(p, n * sizeof(T)); }
+
+  template<typename U> void construct(U* p) { ::new(static_cast<void*>(p)) U; }
+  template<typename U, typename... Args> void construct(U* p, Args&&... args) {
+    ::new(static_cast<void*>(p)) U(std::forward<Args>(args)...);
+  }
+
+  template<typename U> bool operator==(const NumaAllocator<U>&) const { return true; }
+  template<typename U> bool operator!=(const NumaAllocator<U>&) const { return false; }
+};
+
+template<typename T>
+using numa_vector = std::vector<T, NumaAllocator<T> >;
+
+#endif
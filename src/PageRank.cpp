@@ -21,19 +21,52 @@
  *    along with this program; if not, write to the Free Software
  *    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
  */
+#include <atomic>
+#include <chrono>
 #include <cmath> // for fabs() -convergence check
+#include <limits>
+#include <sstream>
+#include <type_traits>
+#include <unordered_map>
 
 #include "PageRank.h"
+#include "GraphStats.h"
+#include "KrylovSolver.h"
+#include "DeltaSolver.h"
+#include "TopRanks.h"
+#include "Parallel.h"
+#include "PerfCounters.h"
 #include "Log.h"
 
 // Constructor receives the PageRank calculation parameters in adition to base class Network
 // constructor parameter.
 PageRank::PageRank(rank_type decay, unsigned int iterations, rank_type epsilon, 
 		   unsigned int growth_rate)
-  : Network( growth_rate), decay_factor_(decay), iterations_(iterations), epsilon_(epsilon) {
+  : Network( growth_rate), decay_factor_(decay), iterations_(iterations), epsilon_(epsilon),
+    precision_(PRECISION_DOUBLE), solver_(SOLVER_POWER), jacobi_(true),
+    extrapolation_(EXTRAPOLATE_NONE), init_(INIT_UNIFORM), stable_top_(0), patience_(0), keep_graph_(false),
+    warm_start_(false), auto_threads_(false), threads_(Parallel::num_threads_),
+    plan_solver_(SOLVER_POWER), plan_float_(false), plan_threads_(1), wide_links_(false) {
   
 }
 
+void PageRank::copy_parameters(const PageRank& other) {
+  growth_rate_ = other.growth_rate_;
+  decay_factor_ = other.decay_factor_;
+  iterations_ = other.iterations_;
+  epsilon_ = other.epsilon_;
+  precision_ = other.precision_;
+  solver_ = other.solver_;
+  jacobi_ = other.jacobi_;
+  extrapolation_ = other.extrapolation_;
+  init_ = other.init_;
+  stable_top_ = other.stable_top_;
+  patience_ = other.patience_;
+  keep_graph_ = other.keep_graph_;
+  auto_threads_ = other.auto_threads_;
+  threads_ = other.threads_;
+}
+
 // Find rank leaks in the network and return a vector of leak Nodes by 
 // reference. Uses the internal function is_rank_leak() to find out whether each node
 // is a rank leak
@@ -41,12 +74,12 @@ PageRank::PageRank(rank_type decay, unsigned int iterations, rank_type epsilon,
 // Complexity : O(N)
 // where 
 //    N - Number of nodes in the network
-bool PageRank::find_rank_leaks(vector<Node>& leaks) {
+bool PageRank::find_rank_leaks(vector<Node>& leaks) const {
+  PerfScope perf("leaks", num_edges_);
   leaks.clear();
   for (node_id_type i=0; i < num_nodes_; ++i) { // O(N) - for each node
     if (is_rank_leak( i)) { 
-      out_citer iter = id_2_node_.find( i);
-      leaks.push_back( iter->second);
+      leaks.push_back( node( i));
     }
   }
   return !leaks.empty();
@@ -77,7 +110,8 @@ bool PageRank::find_rank_leaks(vector<Node>& leaks) {
 //   sink group <= { all visited[] nodes in BFS }
 //   merge sink group (if possible) or create new sink group
 //           
-bool PageRank::find_rank_sinks(vector<vector<Node> >& sinks) {
+bool PageRank::find_rank_sinks(vector<vector<Node> >& sinks) const {
+  PerfScope perf("sinks", num_edges_); // all the BFS : one record per start node would be N records
 
   sinks.clear();
   vector<eNode_Status> status; // status of the node in this sink search
@@ -104,7 +138,7 @@ bool PageRank::find_rank_sinks(vector<vector<Node> >& sinks) {
     visited.resize( num_nodes_) ;
 
     bfs.push( i); // start with i-th node
-    unsigned int num_visited = 0;
+    node_id_type num_visited = 0;
     bool arrives_at_no_sink = false; // BFS exit condition
     node_id_type cur_node;
 
@@ -140,8 +174,8 @@ bool PageRank::find_rank_sinks(vector<vector<Node> >& sinks) {
       }    
       // get all outbound neighbors from the adj_list_
       DEBUG("finding neighbours..." << endl);
-      neighbor_set_type& neighbors = adj_list_[cur_node];
-      for(attr_iter iter = neighbors.begin(); iter != neighbors.end(); ++iter) {
+      const neighbor_set_type& out_links = neighbors( cur_node);
+      for(attr_citer iter = out_links.begin(); iter != out_links.end(); ++iter) {
 	node_id_type next_node = iter->first;
 	if ( !visited[ next_node]) {
 	  bfs.push( next_node);
@@ -178,8 +212,7 @@ bool PageRank::find_rank_sinks(vector<vector<Node> >& sinks) {
       for (unsigned int j = 0; j < connected.size(); ++j) {
 	node_id_type sink_node = connected[j];
 	status[sink_node]= SINK; // mark as a SINK node
-	out_citer iter = id_2_node_.find( sink_node);
-	rank_sink.push_back( iter->second);
+	rank_sink.push_back( node( sink_node));
       }
       
       // check whether the created rank_sink can be  merged with an already created rank sink
@@ -234,21 +267,19 @@ bool PageRank::merge_rank_sinks(vector<vector<Node> >& sinks, vector<Node>& new_
 
 // computes PageRanks on the network
 // Returns a vector<> of PageRanks indexed in unique ID of the Newtork Nodes
-// Complexity (of core alogrithm) : O (N x n_map_avg x ln(n_map_avg) )
+// Complexity (of core alogrithm) : O (I x (N + E))
 // where 
-//    N -         Number of nodes in the network
-//    n_map_avg - Average number of nodes in neighbor ( map<> data structure)
-//
-//    n_map_avg.ln(n_map_avg) = [ n_1.ln(n_1) + n_2.ln(n_2) .... + n_N.ln(n_N)] / N
-//    where
-//        n_1, n_2, ... n_N are number of (outbound) neighbors for each node
+//    I - Number of iterations
+//    N - Number of nodes in the network
+//    E - Number of edges in the network
 // Algorithm :
-// 1. Fix leak nodes - by adding edges to ALL the nodes pointing to a leak node
-// 2. Normalize the adjacency matrix - by transforming 1 => d* 1/L
-// 3. Transpose the normalized adjacency matrix
-// 4. Initialize ranks of t0, and compute the constant term of PageRank ie. (1-d)/N
-// 5. Perform power iteration (core algorithm)
-// 6. Check for convergence (if given)
+// 1. Fix leak nodes and build the transposed link structure (build_in_links())
+// 2. Initialize ranks of t0, and compute the constant term of PageRank ie. (1-d)/N
+// 3. Perform power iteration (core algorithm)
+// 4. Check for convergence (if given)
+// 5. Or for a stable top-K (if given)
+// Steps 2-5 are instantiated for the rank precision (float/double) and the
+// node ID width of the link structure (32/64-bit) selected at run time.
 const vector<rank_type>& PageRank::calculate_PageRanks() {
 
   PRINT(LOG_LVL_2, "Calculation Parameters : " << endl
@@ -256,157 +287,1147 @@ const vector<rank_type>& PageRank::calculate_PageRanks() {
 	<< "iterations   = " << iterations_ << endl
   	<< "epsilon      = " << epsilon_ 
 	<< ((epsilon_ == NO_CONVERGENCE_CHECK)? " <no_converevence_check>" : "") << endl );
-  // 1. Fix leak nodes : rank leaks are fixed by adding edges to ALL the nodes pointing to it
-  //    Ref. Arvind A. et al. Searching the Web, pp 33 : footnote 8 (Alternative solution)
-  PRINT(LOG_LVL_2, "Fixing rank leak nodes..." << endl);
-  int edges_added = 0;
-  for (node_id_type i=0; i < num_nodes_; ++i) { // for each node
-    if (is_rank_leak( i)) { 
-      PRINT(LOG_LVL_3, "For node " <<  (id_2_node_.find( i))->second << endl);
-      back_neighbor_set_type& back_nodes = back_node_set_[i];
-      for(back_neighbor_citer bn= back_nodes.begin(); bn != back_nodes.end(); ++bn) {
-	adj_list_[i][*bn] = 1.0 ; // create link to back node
-	PRINT(LOG_LVL_3, "Creating link " << (id_2_node_.find( i))->second << " -> " 
-	      << (id_2_node_.find( *bn))->second << endl);
-	++edges_added;
+  // 1. Fix leak nodes and build the transposed link structure, plan the solve
+  plan_PageRanks();
+
+  if (plan_solver_ == SOLVER_SCC) {
+    with_in_links([&](const auto& links) { component_iteration( links); });
+  }
+  else if (plan_solver_ == SOLVER_GMRES || plan_solver_ == SOLVER_BICGSTAB) {
+    with_in_links([&](const auto& links) { krylov_solve( links); });
+  }
+  else if (plan_solver_ == SOLVER_DELTA) {
+    with_in_links([&](const auto& links) { delta_solve( links); });
+  }
+  else {
+    PRINT(LOG_LVL_2, "Solver storage : " << (plan_float_? "float" : "double") << " ranks, "
+	  << (wide_links_? 64 : 32) << "-bit node IDs" << endl);
+    with_in_links([&](const auto& links) {
+      typedef typename std::decay<decltype(links)>::type::index_type index_type;
+      if (plan_float_) power_iteration<float, index_type>( links);
+      else power_iteration<double, index_type>( links);
+    });
+  }
+  return page_ranks_;
+}
+
+void PageRank::plan_PageRanks() {
+  {
+    PerfScope perf("build", num_edges_);
+    build_in_links();
+  }
+  with_in_links([&](const auto& links) { make_plan( links); });
+}
+
+// Execution plan : what the caller fixed is kept, the rest is chosen from
+// the statistics of the link structure and of the machine
+// 1. Solver (SOLVER_AUTO) : the power iteration, unless
+//    - d >= PLAN_KRYLOV_MIN_DECAY : the power iteration converges at rate d,
+//      BiCGSTAB much faster (if its vectors fit in memory)
+//    - no component holds more than PLAN_SCC_MAX_LARGEST of the nodes : the
+//      SCC solver solves each one once, upstream first
+//    A fixed number of iterations (no convergence check), the extrapolation,
+//    BlockRank initial ranks, the stable top-K criterion and (for SCC) warm
+//    starts keep the power iteration.
+// 2. Precision (PRECISION_AUTO) : the Krylov, SCC and delta solvers work in
+//    double. The power iteration uses float if epsilon allows it (see
+//    use_float()) and either double ranks don't fit in memory, or the rank
+//    vector is large and its gathers mostly non local : float halves them.
+// 3. Threads (auto threads) : one per PLAN_LINKS_PER_THREAD links, at most
+//    one per core, and no more than the links over the largest row (a row is
+//    never split). NUMA mode keeps the threads the link structure was placed for.
+// Complexity : O(N + E), plus O(N + E) for the components with SOLVER_AUTO
+template<typename Index>
+void PageRank::make_plan(const CompressedGraph<Index>& links) {
+  const bool planning = (solver_ == SOLVER_AUTO || auto_threads_);
+  GraphStats stats = GraphStats();
+  std::ostringstream plan;
+  plan << "Execution plan :" << endl;
+  if (planning) {
+    PerfScope perf("plan", links.num_links());
+    link_stats(links, stats, threads_);
+    machine_stats( stats);
+    size_t leaks = 0;
+    for (node_id_type i = 0; i < num_nodes_; ++i) {
+      leaks += is_rank_leak( i);
+    }
+    stats.dangling = num_nodes_? (double) leaks / num_nodes_ : 0.0;
+    if (solver_ == SOLVER_AUTO) {
+      vector<Index> comp_of, members;
+      vector<size_t> comp_begin;
+      find_components(links, comp_of, members, comp_begin);
+      stats.components = comp_begin.size() - 1;
+      for (size_t c = 0; c < stats.components; ++c) {
+	stats.largest_component = std::max(stats.largest_component, comp_begin[c+1] - comp_begin[c]);
       }
     }
+    plan << stats;
   }
-  if (edges_added) {
-    PRINT(LOG_LVL_2, edges_added << " Edges were aded to fix leak nodes." << endl);
+  const double memory = stats.memory * PLAN_MEMORY_FRACTION;
+  auto fits = [&](eSolver solver, bool float_ranks) {
+    return !stats.memory || solver_memory(solver, float_ranks) <= memory;
+  };
+
+  // 1. solver
+  plan_solver_ = solver_;
+  plan << "  solver : ";
+  if (solver_ != SOLVER_AUTO) {
+    plan << "set by the caller";
   }
   else {
-    PRINT(LOG_LVL_2, "There were no rank leaks to fix" << endl);    
-  }
-  // Free up space used by back_node_set_ vector< map<>> as for the this PageRank tool
-  // the only use of the the back_node_set_ is to perform above step 1. Fix rank sinks
-  // This may be helpful for building transpose of the adj_list_ in step 3
-  // Caution: This invalidate the Network class member back_node_set_ and any operations
-  // depend on it. Hence, not advisable unless really needed to free-up memory
-  back_node_set_.clear();
-
-  // Swap with an empty vector is the only way to gurantee that capacity is reduced and
-  // momeory is released  
-  vector<back_neighbor_set_type>().swap(back_node_set_);
-
-  /*
-  // 2. Adjacency list now have 1.0 in attribute field for each neigbor (outbound)
-  //    Transform this to a normalized matrix with each 
-  //           attribute = d* (1/L) 
-  //    where L - number of neighbors
-  //          d - decay factor
-  // Complexity : O(N x n_map_avg x ln(n_map_avg) )
-  PRINT(LOG_LVL_2, "Normalizing the adjacency matrix..." << endl);
-  for (unsigned int i=0; i < num_nodes_; ++i) { // O(N) x
-    neighbor_set_type& neighbors = adj_list_[i];
-    for(attr_iter iter = neighbors.begin(); iter != neighbors.end(); ++iter) { // O(n_map_avg) 
-      iter->second =  decay_factor_ / neighbors.size(); // d * (1/L) 
-    }
-  }
-
-  // 3. Transpose the normalized adjacency matrix
-  // Complexity : O(N x n_map_avg x ln(n_map_avg))
-  // where 
-  //    N -         Number of nodes in the network
-  //    n_map_avg - Average number of nodes in neighbor ( map<> data structure)
-  PRINT(LOG_LVL_2, "Transposing the normalized adjacency matrix..." << endl);
-  vector<neighbor_set_type> adj_list_transposed_ ;
-  adj_list_transposed_.resize( num_nodes_);
-
-  for (unsigned int i= 0; i < num_nodes_; ++i) { // O(N) 
-    neighbor_set_type& neighbors = adj_list_[i];
-    for(attr_citer iter = neighbors.begin(); iter != neighbors.end(); ++iter) { // O(n_map_avg)
-      // transposed entry
-      adj_list_transposed_[iter->first][i] = iter->second; // ln(n_map_avg) 
-    }
-  }
-  */
-
-  // 2 + 3 : Normalize AND Transporse the Adjacency matrix (above Step #2 & #3 ) in one go !
-  //         Normalize = d* (1/L)
-  //         where L - number of neighbors
-  //               d - decay factor
-  //         Transpose adj_list_transpose_[i][j] <==> adj_list_[j][i]
-  //
-  // Complexity : O(N x n_map_avg x ln(n_map_avg))
-  // where 
-  //    N -         Number of nodes in the network
-  //    n_map_avg - Average number of nodes in neighbor ( map<> data structure)
-  PRINT(LOG_LVL_2, "Normalizing and Transposing the adjacency matrix..." << endl);
-  vector<neighbor_set_type> adj_list_transposed_ ;
-  adj_list_transposed_.resize( num_nodes_);
-
-  for (unsigned int i= 0; i < num_nodes_; ++i) { // O(N) 
-    neighbor_set_type& neighbors = adj_list_[i];
-    for(attr_citer iter = neighbors.begin(); iter != neighbors.end(); ++iter) { // O(n_map_avg)
-      // transposed entry <= normalized value
-      adj_list_transposed_[iter->first][i] = decay_factor_ / neighbors.size() ; // ln(n_map_avg) 
+    plan_solver_ = SOLVER_POWER;
+    if (epsilon_ == NO_CONVERGENCE_CHECK) {
+      plan << "power iteration, for a fixed number of iterations";
+    }
+    else if (extrapolation_ != EXTRAPOLATE_NONE || init_ == INIT_BLOCKRANK) {
+      plan << "power iteration, for its extrapolation / initial ranks";
+    }
+    else if (stable_top_) {
+      plan << "power iteration, for the stable top " << stable_top_ << " criterion";
+    }
+    else if (decay_factor_ >= PLAN_KRYLOV_MIN_DECAY && fits(SOLVER_BICGSTAB, false)) {
+      plan_solver_ = SOLVER_BICGSTAB;
+      plan << "BiCGSTAB, decay factor " << decay_factor_ << " >= " << PLAN_KRYLOV_MIN_DECAY
+	   << " : the power iteration converges at rate d";
+    }
+    else if (stats.components > 1 && stats.largest_component <= PLAN_SCC_MAX_LARGEST * num_nodes_ &&
+	     !(warm_start_ && !page_ranks_.empty())) {
+      plan_solver_ = SOLVER_SCC;
+      plan << "SCC, no component holds more than " << 100 * PLAN_SCC_MAX_LARGEST 
+	   << "% of the nodes : each one is solved once";
+    }
+    else if (decay_factor_ >= PLAN_KRYLOV_MIN_DECAY) {
+      plan << "power iteration, BiCGSTAB needs " << (solver_memory(SOLVER_BICGSTAB, false) >> 20)
+	   << " MB";
+    }
+    else {
+      plan << "power iteration, decay factor " << decay_factor_ << " < " << PLAN_KRYLOV_MIN_DECAY;
+      if (stats.components > 1) {
+	plan << " and a component of " << 100.0 * stats.largest_component / num_nodes_ << "% of the nodes";
+      }
     }
   }
-  
+  plan << endl;
 
-  
-  // 4. PR(t+1) = d*[A]T * PR(t) + (1-d)/ N
+  // 2. precision
+  plan_float_ = use_float();
+  plan << "  ranks  : " << (wide_links_? 64 : 32) << "-bit node IDs, ";
+  if (plan_solver_ != SOLVER_POWER) {
+    plan_float_ = false;
+    plan << "double (the solver's)";
+  }
+  else if (precision_ != PRECISION_AUTO || !planning) {
+    plan << (plan_float_? "float" : "double") << ((precision_ != PRECISION_AUTO)? ", set by the caller" : "");
+  }
+  else if (epsilon_ != NO_CONVERGENCE_CHECK && epsilon_ * num_nodes_ < FLOAT_AUTO_MIN_EPSILON) {
+    plan_float_ = false;
+    plan << "double, epsilon x N below " << FLOAT_AUTO_MIN_EPSILON;
+  }
+  else if (!fits(SOLVER_POWER, false) && fits(SOLVER_POWER, true)) {
+    plan_float_ = true;
+    plan << "float, double ranks need " << (solver_memory(SOLVER_POWER, false) >> 20) << " MB";
+  }
+  else if (num_nodes_ >= FLOAT_AUTO_MIN_NODES && stats.locality < PLAN_FLOAT_MAX_LOCALITY) {
+    plan_float_ = true;
+    plan << "float, " << 100.0 * (1 - stats.locality) << "% non local links : float halves the gathers";
+  }
+  else {
+    plan_float_ = false;
+    plan << "double, " << ((num_nodes_ < FLOAT_AUTO_MIN_NODES)? "small rank vector" : "mostly local links");
+  }
+  plan << endl;
+
+  // 3. threads
+  plan_threads_ = threads_;
+  plan << "  threads : ";
+  if (!auto_threads_) {
+    plan << plan_threads_ << ", set by the caller";
+  }
+  else if (Numa::enabled_) {
+    plan << plan_threads_ << ", NUMA mode : the link structure is placed for them";
+  }
+  else {
+    size_t by_size = std::max<size_t>(links.num_links() / PLAN_LINKS_PER_THREAD, 1);
+    size_t by_rows = stats.max_in_links? std::max<size_t>(links.num_links() / stats.max_in_links, 1) : 1;
+    size_t cores = std::max(stats.cores, 1u);
+    plan_threads_ = std::min(std::min(by_size, by_rows), cores);
+    plan << plan_threads_ << ", " << ((plan_threads_ == cores)? string("one per core")
+				      : (plan_threads_ == by_size)? "one per " + std::to_string(PLAN_LINKS_PER_THREAD) + " links"
+				      : "links over the largest row");
+  }
+  plan << endl;
+  plan_ = plan.str();
+  PRINT(LOG_LVL_2, plan_);
+}
+
+// Approximate working memory of the solvers : N times the vectors they keep
+size_t PageRank::solver_memory(eSolver solver, bool float_ranks) const {
+  const size_t N = num_nodes_;
+  switch (solver) {
+  case SOLVER_SCC : // ranks, new ranks, upstream sums, components
+    return N * (4 * sizeof(rank_type) + 4 * sizeof(node_id_type));
+  case SOLVER_GMRES : // Krylov basis and 9 vectors
+    return N * sizeof(double) * (GMRES_RESTART + 10);
+  case SOLVER_BICGSTAB : // 14 vectors
+    return N * sizeof(double) * 14;
+  case SOLVER_DELTA : // 7 vectors and the forward link structure
+    return N * (sizeof(double) * 7 + sizeof(size_t)) + num_edges_ * sizeof(node_id_type);
+  default : // ranks, new ranks, scaled ranks (and the result)
+    return N * (3 * (float_ranks? sizeof(float) : sizeof(double)) + sizeof(rank_type));
+  }
+}
+
+// Power iteration with the ranks stored as Real (see calculate_PageRanks())
+template<typename Real, typename Index>
+void PageRank::power_iteration(const CompressedGraph<Index>& links) {
+
+  // 2. PR(t+1) = d*[A]T * PR(t) + (1-d)/ N
   //    Calculate the second constant term which need to be added to page_rank
   //    No need to calculate this repeatedly
   rank_type rank_const = (1- decay_factor_) / num_nodes_ ; //  (1-d)/ N
   
-  // Create page_ranks_ vector with initial (t0) values : init_val = 1/N, equal ranks to all nodes
-  page_ranks_.resize( num_nodes_);
-  fill(page_ranks_.begin(), page_ranks_.end(), 1.0/num_nodes_); // initial rank = 1/N
-
+  // Create ranks vector with initial (t0) values : init_val = 1/N, equal ranks to all nodes
   // New ranks (t+1) are calculated to a new array to check for convergence
-  vector<rank_type> new_ranks;
-  new_ranks.resize( num_nodes_);
-
-  // 5. Calculate : PR(k+1) = (d/L) * PR(k) + rank_const
-  //    Using adj_list_transposed_ instead of adj_list_ (with swapped col/row access
-  //    to mimic the transposition) has a significant performace gain due the
-  //    underlaying vector<map<>> structure:
-  //    Using adj_list_            : O(N^2 x ln(n_map_avg) )
-  //          adj_list_transposed_ : O(N x n_map_avg x ln(n_map_avg) )
-  //    where N >> n_map_avg
+  numa_vector<Real> ranks( num_nodes_), new_ranks( num_nodes_);
+  numa_vector<Real> scaled( num_nodes_); // working space of pull_sweep()
+  vector<rank_type> seed; // warm start or BlockRank initial ranks
+  if (!warm_start_ranks( seed) && init_ == INIT_BLOCKRANK) {
+    block_rank_seed(links, seed);
+  }
+  const unsigned int num_threads = plan_threads_;
+  parallel_run(num_threads, [&](unsigned int t) { // first touch by the worker of the rows
+    Index last = links.node_partition(num_threads, t+1);
+    for (Index j = links.node_partition(num_threads, t); j < last; ++j) {
+      ranks[j] = seed.empty()? 1.0/num_nodes_ : seed[j]; // initial rank = 1/N
+      new_ranks[j] = scaled[j] = 0.0;
+    }
+  });
+
+  // Extrapolation : the iterates before each extrapolation are kept in history,
+  // and the plain iterate in plain_ranks until the next step shows whether the
+  // extrapolated ranks are any better (smaller change)
+  const unsigned int window = (extrapolation_ == EXTRAPOLATE_QUADRATIC)? 3 
+    : (extrapolation_ == EXTRAPOLATE_AITKEN)? 2 : 0;
+  vector<numa_vector<Real> > history( window);
+  numa_vector<Real> plain_ranks;
+  unsigned int since = 0; // steps since the start or the last extrapolation
+  rank_type last_change = 0.0;
+  bool extrapolated = false;
+  TopRanks top(stable_top_, plan_threads_); // stable top-K criterion
+
+  // 3. Calculate : PR(k+1) = d * [A]T * PR(k) + rank_const
   PRINT(LOG_LVL_2, "Performing power iteration..." << endl);
-  for (unsigned int k=0; k < iterations_; ++k) {
+  PerfScope perf("power iteration", 0);
+  double sweep_secs = 0.0;
+  unsigned int sweeps = 0;
+  unsigned int k = 0;
+  auto sweep = [&]() { // new_ranks from ranks, timed
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    {
+      PerfScope perf_sweep("sweep", links.num_links(), k+1);
+      pull_sweep(links, ranks, new_ranks, scaled, decay_factor_, rank_const);
+    }
+    sweep_secs += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    ++sweeps;
+  };
+  for (k=0; k < iterations_; ++k) {
     PRINT(LOG_LVL_2, "Iteration #" << k+1 << endl);
     
-    // PageRank core computation loop
-    // complexity : O (N x n_map_avg x ln(n_map_avg) )
-    // where 
-    //    N -         Number of nodes in the network
-    //    n_map_avg - Average number of nodes in neighbor ( map<> data structure)
-    //
-    //    n_map_avg.ln(n_map_avg) = [ n_1.ln(n_1) + n_2.ln(n_2) .... + n_N.ln(n_N)] / N
-    //    where
-    //        n_1, n_2, ... n_N are number of (outbound) neighbors for each node
-    //
-    for (unsigned int i= 0; i < num_nodes_; ++i) { // O(N)
-      new_ranks[i]= rank_const; 
-      neighbor_set_type& neighbors = adj_list_transposed_[i]; // O(const)
-      for(attr_citer iter = neighbors.begin(); iter != neighbors.end(); ++iter) { // O(n_map_avg) 
-	new_ranks[i] += iter->second * page_ranks_[iter->first] ;
-      }
-    }
+    // PageRank core computation : complexity O(N + E)
+    sweep();
 
 #ifndef NDEBUG
     DEBUG("PageRanks calculated at Iteration : " << k+1 << endl);
-    ostream_iterator<double> out (cout,"\n");
+    ostream_iterator<Real> out (cout,"\n");
     copy (new_ranks.begin(), new_ranks.end(), out );
 #endif
 
-    // 6. Check for convergence between new_ranks and page_ranks_
+    // safeguard : an extrapolation which increased the change is dropped, and
+    // this iteration sweeps the plain iterate instead, so that the checks
+    // below (and the progress callback) still see one step of the iteration
+    if (window) {
+      rank_type change = max_change(new_ranks, ranks);
+      if (extrapolated && change > last_change) {
+	PRINT(LOG_LVL_2, "Extrapolation rejected (change " << change << " > " << last_change << ")" << endl);
+	ranks.swap( plain_ranks);
+	sweep();
+	change = max_change(new_ranks, ranks);
+      }
+      extrapolated = false;
+      last_change = change;
+    }
+
+    // 4. Check for convergence between new_ranks and ranks
     if ((epsilon_!= NO_CONVERGENCE_CHECK) &&  //bad double/float equivalnce check, but OK for const -1.0
-	is_converged(new_ranks, page_ranks_, epsilon_) ) { 
+	is_converged(new_ranks, ranks, epsilon_) ) { 
       PRINT(LOG_LVL_2, "PageRanks converged within the given accuracy." << endl 
 	            << "Terminating power iteration" << endl);
       break;
     }
 
-    // copy new ranks(t+1 ) -> page_ranks to start a new iteration
-    copy(new_ranks.begin(), new_ranks.end(), page_ranks_.begin());    
+    // 5. Stable top-K : the ranks used downstream no longer change
+    if (stable_top_ && top.update(new_ranks.data(), new_ranks.size()) >= patience_) {
+      PRINT(LOG_LVL_1, "Top " << top.top().size() << " ranks stable for " << patience_
+	    << " iteration(s) : power iteration stopped at iteration #" << k+1 << ", residual "
+	    << (window? last_change : max_change(new_ranks, ranks)) << endl);
+      ranks.swap( new_ranks);
+      break;
+    }
+
+    if (progress_ && !progress_(k+1, window? last_change : max_change(new_ranks, ranks))) {
+      PRINT(LOG_LVL_2, "Power iteration stopped at iteration #" << k+1 << endl);
+      ranks.swap( new_ranks);
+      break;
+    }
+
+    // new ranks(t+1 ) -> ranks to start a new iteration
+    ranks.swap( new_ranks);
+
+    if (window && ++since >= EXTRAPOLATION_PERIOD - window) {
+      if (since < EXTRAPOLATION_PERIOD) { // keep the iterates before the extrapolation
+	history[since - (EXTRAPOLATION_PERIOD - window)].assign( ranks.begin(), ranks.end());
+      }
+      else {
+	since = 0;
+	extrapolated = extrapolate(history, ranks);
+	if (extrapolated) {
+	  PRINT(LOG_LVL_2, "Extrapolated ranks" << endl);
+	  ranks.swap( history[0]); // ranks <- extrapolated ranks
+	  plain_ranks.swap( history[0]);
+	}
+      }
+    }
+  }
+  perf.set_edges( links.num_links() * sweeps);
+  if (sweeps && sweep_secs > 0.0) {
+    PRINT(LOG_LVL_2, sweeps << " sweeps in " << sweep_secs << " s : " 
+	  << links.num_links() * sweeps / sweep_secs << " Edges/s" << endl);
   }
 
-  return page_ranks_;
+  page_ranks_.assign( ranks.begin(), ranks.end());
+}
+
+// Solve (I - d P^T) x = (1-d)/N with GMRES or BiCGSTAB, from x = 1/N (or the
+// warm start ranks)
+// iterations_ limits the number of sweeps (applications of P^T) and the
+// solver stops when the max-norm residual, ie. the change one power iteration
+// would make, is below epsilon_.
+template<typename Index>
+void PageRank::krylov_solve(const CompressedGraph<Index>& links) {
+  typedef KrylovSolver<Index> Solver;
+  typename Solver::eMethod method = (plan_solver_ == SOLVER_GMRES)? Solver::GMRES : Solver::BICGSTAB;
+  PRINT(LOG_LVL_2, "Solving the linear system with " << ((method == Solver::GMRES)? "GMRES" : "BiCGSTAB")
+	<< (jacobi_? ", Jacobi preconditioner" : "") << endl);
+  PerfScope perf("krylov", 0);
+  Solver solver(links, decay_factor_, jacobi_, plan_threads_);
+  solver.set_progress( progress_);
+  vector<rank_type> b( num_nodes_, (1 - decay_factor_) / num_nodes_); // (1-d)/N
+  vector<rank_type> x;
+  if (!warm_start_ranks( x)) {
+    x.assign( num_nodes_, 1.0 / num_nodes_);
+  }
+  unsigned int sweeps = solver.solve(method, b, x, iterations_, epsilon_);
+  perf.set_edges( links.num_links() * sweeps);
+  const vector<double>& history = solver.residual_history();
+  PRINT(LOG_LVL_2, sweeps << " sweeps, final residual " << history.back() << endl);
+  page_ranks_.swap( x);
+}
+
+// Delta-PageRank from x = 1/N (or the warm start ranks) : the rounds stop
+// when no node has a residual (the change a power iteration would make to
+// its rank) above epsilon_, or after iterations_ rounds.
+template<typename Index>
+void PageRank::delta_solve(const CompressedGraph<Index>& links) {
+  PRINT(LOG_LVL_2, "Propagating rank changes (delta-PageRank)..." << endl);
+  PerfScope perf("delta", 0);
+  DeltaSolver<Index> solver(links, decay_factor_, plan_threads_);
+  solver.set_progress( progress_);
+  vector<rank_type> b( num_nodes_, (1 - decay_factor_) / num_nodes_); // (1-d)/N
+  vector<rank_type> x;
+  if (!warm_start_ranks( x)) {
+    x.assign( num_nodes_, 1.0 / num_nodes_);
+  }
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  unsigned int rounds = solver.solve(b, x, iterations_, epsilon_);
+  double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  perf.set_edges( solver.links_visited());
+  PRINT(LOG_LVL_2, rounds << " rounds (" << solver.push_rounds() << " push, " << solver.pull_rounds()
+	<< " pull) : " << solver.links_visited() << " links visited, "
+	<< (double) solver.links_visited() / std::max<size_t>(links.num_links(), 1) << " sweeps worth" << endl);
+  if (secs > 0.0) {
+    PRINT(LOG_LVL_2, "Delta rounds in " << secs << " s : " << solver.links_visited() / secs << " Edges/s" << endl);
+  }
+  page_ranks_.swap( x);
+}
+
+bool PageRank::warm_start_ranks(vector<rank_type>& seed) const {
+  if (!warm_start_ || page_ranks_.empty() || page_ranks_.size() > num_nodes_) {
+    return false;
+  }
+  // the previous ranks sum up to 1 over the previous nodes : scaled to sum up
+  // to their share of the nodes, the whole vector sums up to 1
+  const rank_type scale = (rank_type) page_ranks_.size() / num_nodes_;
+  seed.assign( num_nodes_, 1.0 / num_nodes_);
+  for (size_t i = 0; i < page_ranks_.size(); ++i) {
+    seed[i] = page_ranks_[i] * scale;
+  }
+  PRINT(LOG_LVL_2, "Warm start from the PageRanks of " << page_ranks_.size() << " node(s)" << endl);
+  return true;
+}
+
+// host part of a URL : after "<scheme>://" up to the first '/'
+static std::string_view url_host(std::string_view url) {
+  std::string_view host( url);
+  size_t scheme = host.find("://");
+  if (scheme != std::string_view::npos) host.remove_prefix( scheme + 3);
+  return host.substr(0, host.find('/'));
+}
+
+// BlockRank initial ranks (Kamvar et al., Exploiting the Block Structure of
+// the Web for Computing PageRank) :
+// 1. Group the nodes into blocks by the host of their URL
+// 2. Local PageRank of each block on its intra-host links, blocks in parallel
+// 3. Collapse the blocks into a host graph : the link weight from host J to
+//    host I is the local rank flowing along the links from J to I
+// 4. PageRank of the host graph
+// 5. seed(i) = local rank of i x rank of its host
+// Most links of a crawl are intra-host, so steps 2-4 are cheap and the seed
+// is close to the global PageRanks. Local and host iterations stop at
+// epsilon_ (BLOCKRANK_EPSILON without convergence check) or iterations_.
+// Complexity : O(N + E) per local/host iteration
+template<typename Index>
+bool PageRank::block_rank_seed(const CompressedGraph<Index>& links, vector<rank_type>& seed) const {
+  PRINT(LOG_LVL_2, "Computing BlockRank initial ranks..." << endl);
+  const Index N = links.num_nodes();
+  const rank_type d = decay_factor_;
+  const rank_type epsilon = (epsilon_ == NO_CONVERGENCE_CHECK)? BLOCKRANK_EPSILON : epsilon_;
+
+  // 1. Blocks : host IDs in order of first appearance
+  vector<Index> host_of( N, 0);
+  std::unordered_map<std::string_view, Index> host_ids;
+  for (Index i = 0; i < N; ++i) {
+    host_of[i] = host_ids.emplace(url_host( url( i)), host_ids.size()).first->second;
+  }
+  const Index H = host_ids.size();
+  if (H <= 1 || H == N) {
+    PRINT(LOG_LVL_2, "No host structure (" << H << " hosts for " << N 
+	  << " nodes), starting from uniform ranks" << endl);
+    return false;
+  }
+  vector<size_t> host_begin( H + 1, 0); // nodes of host h : members[host_begin[h] .. host_begin[h+1])
+  for (Index i = 0; i < N; ++i) ++host_begin[host_of[i] + 1];
+  std::partial_sum(host_begin.begin(), host_begin.end(), host_begin.begin());
+  vector<Index> members( N);
+  vector<size_t> fill_pos( host_begin.begin(), host_begin.end() - 1);
+  for (Index i = 0; i < N; ++i) members[fill_pos[host_of[i]]++] = i;
+
+  vector<Index> intra_out( N, 0); // intra-host out links of each node
+  size_t intra_links = 0;
+  for (Index i = 0; i < N; ++i) {
+    for (size_t l = links.row_offsets_[i]; l < links.row_offsets_[i+1]; ++l) {
+      if (host_of[links.links_[l]] == host_of[i]) {
+	++intra_out[links.links_[l]];
+	++intra_links;
+      }
+    }
+  }
+  PRINT(LOG_LVL_2, H << " hosts, " << 100.0 * intra_links / std::max<size_t>(links.num_links(), 1)
+	<< "% intra-host links" << endl);
+
+  // 2. Local PageRank of each host, normalized to 1 within the host
+  vector<rank_type> local( N), new_local( N);
+  std::atomic<size_t> next_host(0);
+  parallel_run(plan_threads_, [&](unsigned int t) {
+    for (size_t h = next_host++; h < H; h = next_host++) {
+      const Index* first = &members[0] + host_begin[h];
+      const size_t size = host_begin[h+1] - host_begin[h];
+      for (size_t m = 0; m < size; ++m) local[first[m]] = 1.0 / size;
+      for (unsigned int k = 0; k < iterations_; ++k) {
+	rank_type diff = 0.0;
+	for (size_t m = 0; m < size; ++m) {
+	  Index i = first[m];
+	  double sum = 0.0;
+	  for (size_t l = links.row_offsets_[i]; l < links.row_offsets_[i+1]; ++l) {
+	    Index j = links.links_[l];
+	    if (host_of[j] == h) sum += local[j] / intra_out[j];
+	  }
+	  new_local[i] = (1 - d) / size + d * sum;
+	  diff = std::max(diff, (rank_type) fabs(new_local[i] - local[i]));
+	}
+	for (size_t m = 0; m < size; ++m) local[first[m]] = new_local[first[m]];
+	if (diff < epsilon) break;
+      }
+      double total = 0.0; // rank lost at the nodes without intra-host links
+      for (size_t m = 0; m < size; ++m) total += local[first[m]];
+      for (size_t m = 0; m < size; ++m) local[first[m]] /= total;
+    }
+  });
+
+  // 3. Host graph : in-links of each host with their weights
+  vector<vector<std::pair<Index, rank_type> > > host_in( H);
+  vector<rank_type> host_out( H, 0.0); // total weight of the links out of each host
+  for (Index j = 0; j < N; ++j) {
+    if (links.out_weight_[j] > 0.0) host_out[host_of[j]] += local[j];
+  }
+  next_host = 0;
+  parallel_run(plan_threads_, [&](unsigned int t) {
+    std::unordered_map<Index, rank_type> weights;
+    for (size_t h = next_host++; h < H; h = next_host++) {
+      weights.clear();
+      for (size_t m = host_begin[h]; m < host_begin[h+1]; ++m) {
+	Index i = members[m];
+	for (size_t l = links.row_offsets_[i]; l < links.row_offsets_[i+1]; ++l) {
+	  Index j = links.links_[l];
+	  if (links.out_weight_[j] > 0.0) weights[host_of[j]] += local[j] * links.out_weight_[j];
+	}
+      }
+      host_in[h].assign( weights.begin(), weights.end());
+    }
+  });
+
+  // 4. PageRank of the host graph
+  vector<rank_type> host_rank( H, 1.0 / H), new_host_rank( H);
+  for (unsigned int k = 0; k < iterations_; ++k) {
+    rank_type diff = 0.0;
+    for (Index h = 0; h < H; ++h) {
+      double sum = 0.0;
+      for (size_t l = 0; l < host_in[h].size(); ++l) {
+	Index g = host_in[h][l].first;
+	sum += host_rank[g] * host_in[h][l].second / host_out[g];
+      }
+      new_host_rank[h] = (1 - d) / H + d * sum;
+      diff = std::max(diff, (rank_type) fabs(new_host_rank[h] - host_rank[h]));
+    }
+    host_rank.swap( new_host_rank);
+    if (diff < epsilon) break;
+  }
+
+  // 5. Seed : local rank x host rank
+  seed.resize( N);
+  for (Index i = 0; i < N; ++i) {
+    seed[i] = local[i] * host_rank[host_of[i]];
+  }
+  return true;
+}
+
+// Solve PageRanks component by component (SOLVER_SCC)
+// PR(i) depends only on the nodes upstream of i, so with the strongly connected
+// components in topological order the ranks flowing into a component from
+// upstream are final by the time it is solved:
+//   PR(i) = (1-d)/N + d * [ sum_upstream PR(j)/L(j) + sum_{j in C} PR(j)/L(j) ]
+// The upstream sum is computed once and only the links inside the component
+// are iterated, until the component converges within epsilon_ (or for
+// iterations_ steps). Components without inner links are exact in one step.
+// Components at the same depth of the condensation DAG don't depend on each
+// other and are solved in parallel; a large component alone gets all the
+// threads for its rows.
+// Complexity : O(N + E) for the components + sum over components of
+// I(C) x (N(C) + E(C)), I(C) being the steps component C needs
+template<typename Index>
+void PageRank::component_iteration(const CompressedGraph<Index>& links) {
+  PRINT(LOG_LVL_2, "Finding strongly connected components..." << endl);
+  vector<Index> comp_of, members;
+  vector<size_t> comp_begin;
+  {
+    PerfScope perf("components", links.num_links());
+    find_components(links, comp_of, members, comp_begin);
+  }
+  const size_t num_comps = comp_begin.size() - 1;
+
+  // depth of each component in the condensation DAG : 1 + deepest upstream one
+  vector<Index> depth( num_comps, 0);
+  Index max_depth = 0;
+  size_t largest = 0;
+  for (size_t c = 0; c < num_comps; ++c) {
+    for (size_t m = comp_begin[c]; m < comp_begin[c+1]; ++m) {
+      Index i = members[m];
+      for (size_t l = links.row_offsets_[i]; l < links.row_offsets_[i+1]; ++l) {
+	Index j = links.links_[l];
+	if (comp_of[j] != c) depth[c] = std::max<Index>(depth[c], depth[comp_of[j]] + 1);
+      }
+    }
+    max_depth = std::max(max_depth, depth[c]);
+    largest = std::max(largest, comp_begin[c+1] - comp_begin[c]);
+  }
+  vector<size_t> level_begin( max_depth + 2, 0); // components by depth, in counting sort
+  for (size_t c = 0; c < num_comps; ++c) ++level_begin[depth[c] + 1];
+  std::partial_sum(level_begin.begin(), level_begin.end(), level_begin.begin());
+  vector<size_t> by_level( num_comps);
+  vector<size_t> fill_pos( level_begin.begin(), level_begin.end() - 1);
+  for (size_t c = 0; c < num_comps; ++c) by_level[fill_pos[depth[c]]++] = c;
+  PRINT(LOG_LVL_2, num_comps << " components in " << max_depth + 1 << " levels, largest "
+	<< largest << " nodes" << endl);
+
+  const rank_type rank_const = (1- decay_factor_) / num_nodes_ ; //  (1-d)/ N
+  const rank_type decay = decay_factor_;
+  vector<rank_type> ranks( num_nodes_, 1.0/num_nodes_); // initial rank = 1/N
+  vector<rank_type> new_ranks( num_nodes_);
+  vector<rank_type> upstream( num_nodes_); // rank_const + d * upstream sum
+  std::atomic<unsigned long long> link_visits(0);
+
+  // solve component c with its rows split over num_threads threads
+  auto solve = [&](size_t c, unsigned int num_threads) {
+    const Index* first = &members[0] + comp_begin[c];
+    const size_t size = comp_begin[c+1] - comp_begin[c];
+    bool inner_links = false;
+    unsigned long long visits = 0;
+    double inflow = 0.0, inner_weight = 0.0;
+    for (size_t m = 0; m < size; ++m) { // upstream ranks are final
+      Index i = first[m];
+      double sum = 0.0;
+      for (size_t l = links.row_offsets_[i]; l < links.row_offsets_[i+1]; ++l) {
+	Index j = links.links_[l];
+	if (comp_of[j] != c) sum += ranks[j] * links.out_weight_[j];
+	else {
+	  inner_links = true;
+	  inner_weight += links.out_weight_[j];
+	}
+      }
+      upstream[i] = rank_const + decay * sum;
+      inflow += upstream[i];
+      visits += links.row_offsets_[i+1] - links.row_offsets_[i];
+    }
+    if (!inner_links) { // no inner links : final already
+      for (size_t m = 0; m < size; ++m) {
+	ranks[first[m]] = upstream[first[m]];
+      }
+      link_visits += visits;
+      return;
+    }
+    // Initial ranks : equal, with the total rank the component holds in the
+    // steady state if all of its nodes keep the same share of their rank in
+    // it. The total rank is the slowest mode of the iteration (it decays with
+    // d only), so this is exact for the components no rank flows out of.
+    double retained = inner_weight / size; // mean share of rank kept in the component
+    double init = inflow / (1 - decay * retained) / size;
+    for (size_t m = 0; m < size; ++m) {
+      ranks[first[m]] = init;
+    }
+    vector<double> max_diff( num_threads);
+    for (unsigned int k = 0; k < iterations_; ++k) {
+      parallel_run(num_threads, [&](unsigned int t) {
+	double diff = 0.0;
+	size_t last = partition_begin(size, num_threads, t+1);
+	for (size_t m = partition_begin(size, num_threads, t); m < last; ++m) {
+	  Index i = first[m];
+	  double sum = 0.0;
+	  for (size_t l = links.row_offsets_[i]; l < links.row_offsets_[i+1]; ++l) {
+	    Index j = links.links_[l];
+	    if (comp_of[j] == c) sum += ranks[j] * links.out_weight_[j];
+	  }
+	  new_ranks[i] = upstream[i] + decay * sum;
+	  diff = std::max(diff, (double) fabs(new_ranks[i] - ranks[i]));
+	}
+	max_diff[t] = diff;
+      });
+      for (size_t m = 0; m < size; ++m) {
+	ranks[first[m]] = new_ranks[first[m]];
+      }
+      for (size_t m = 0; m < size; ++m) {
+	visits += links.row_offsets_[first[m]+1] - links.row_offsets_[first[m]];
+      }
+      if (epsilon_ != NO_CONVERGENCE_CHECK &&
+	  *std::max_element(max_diff.begin(), max_diff.end()) < epsilon_) {
+	break;
+      }
+    }
+    link_visits += visits;
+  };
+
+  PRINT(LOG_LVL_2, "Solving components..." << endl);
+  PerfScope perf("scc", 0);
+  const unsigned int num_threads = plan_threads_;
+  vector<size_t> small; // components of a level solved on one thread each
+  for (Index level = 0; level <= max_depth; ++level) {
+    small.clear();
+    size_t small_nodes = 0;
+    for (size_t b = level_begin[level]; b < level_begin[level+1]; ++b) {
+      size_t c = by_level[b], size = comp_begin[c+1] - comp_begin[c];
+      if (num_threads > 1 && size >= SCC_PARALLEL_MIN_NODES) { // large : all threads on its rows
+	solve(c, num_threads);
+      }
+      else {
+	small.push_back( c);
+	small_nodes += size;
+      }
+    }
+    if (num_threads == 1 || small.size() == 1 || small_nodes < SCC_PARALLEL_MIN_NODES) {
+      for (size_t s = 0; s < small.size(); ++s) solve(small[s], 1);
+    }
+    else {
+      std::atomic<size_t> next(0); // independent components : one thread each
+      parallel_run(num_threads, [&](unsigned int t) {
+	for (size_t s = next++; s < small.size(); s = next++) {
+	  solve(small[s], 1);
+	}
+      });
+    }
+    if (progress_ && !progress_(level + 1, 0.0)) {
+      PRINT(LOG_LVL_2, "Stopped after the components of level " << level << endl);
+      break;
+    }
+  }
+  perf.set_edges( link_visits);
+  PRINT(LOG_LVL_2, link_visits << " link visits (" << (double) link_visits / std::max<size_t>(links.num_links(), 1)
+	<< " sweeps of the network)" << endl);
+  page_ranks_.assign( ranks.begin(), ranks.end());
+}
+
+// Tarjan's algorithm (iterative) on the in-links : a component is complete
+// once everything reachable from it over in-links, ie. everything upstream of
+// it, is complete. So the components come out in topological order.
+// Complexity : O(N + E)
+template<typename Index>
+void PageRank::find_components(const CompressedGraph<Index>& links, vector<Index>& comp_of,
+			       vector<Index>& members, vector<size_t>& comp_begin) const {
+  const Index UNVISITED = std::numeric_limits<Index>::max();
+  const Index N = links.num_nodes();
+  vector<Index> index( N, UNVISITED), low( N);
+  std::vector<bool> on_stack( N);
+  vector<Index> stack; // nodes of the open components
+  vector<std::pair<Index, size_t> > call; // DFS path : node, next in-link to follow
+  comp_of.assign( N, 0);
+  members.clear();
+  members.reserve( N);
+  comp_begin.assign( 1, 0);
+  Index counter = 0;
+  for (Index s = 0; s < N; ++s) {
+    if (index[s] != UNVISITED) continue;
+    index[s] = low[s] = counter++;
+    stack.push_back( s);
+    on_stack[s] = true;
+    call.push_back( std::make_pair(s, links.row_offsets_[s]));
+    while (!call.empty()) {
+      Index v = call.back().first;
+      size_t& pos = call.back().second;
+      if (pos < links.row_offsets_[v+1]) {
+	Index w = links.links_[pos++];
+	if (index[w] == UNVISITED) { // descend
+	  index[w] = low[w] = counter++;
+	  stack.push_back( w);
+	  on_stack[w] = true;
+	  call.push_back( std::make_pair(w, links.row_offsets_[w]));
+	}
+	else if (on_stack[w]) {
+	  low[v] = std::min(low[v], index[w]);
+	}
+	continue;
+      }
+      call.pop_back();
+      if (!call.empty()) {
+	Index parent = call.back().first;
+	low[parent] = std::min(low[parent], low[v]);
+      }
+      if (low[v] == index[v]) { // v is the root of a component
+	Index comp = comp_begin.size() - 1, w;
+	do {
+	  w = stack.back();
+	  stack.pop_back();
+	  on_stack[w] = false;
+	  comp_of[w] = comp;
+	  members.push_back( w);
+	} while (w != v);
+	comp_begin.push_back( members.size());
+      }
+    }
+  }
+}
+
+// Extrapolation of the iterates x(k) = PR* + sum c(i) l(i)^k u(i), which
+// cancels the components of the largest eigenvalues l(i) of d[A]T
+// (cf. Kamvar et al., Extrapolation Methods for Accelerating PageRank Computations)
+// Aitken    : one dominant component per rank, from x(k-2), x(k-1), x(k)
+//             PR*(i) = x(k)(i) - dx(k)(i)^2 / (dx(k)(i) - dx(k-1)(i))
+// Quadratic : the differences dx(j) = x(j) - x(j-1) of two components satisfy
+//             dx(k) + a1 dx(k-1) + a2 dx(k-2) = 0, a1 and a2 are fitted by least
+//             squares over the ranks, and PR* = (x(k) + a1 x(k-1) + a2 x(k-2)) / (1 + a1 + a2)
+// The iteration of this tool is affine (no normalization step), so the
+// quadratic form is the one of the minimal polynomial of the error.
+template<typename Real>
+bool PageRank::extrapolate(vector<numa_vector<Real> >& history, const numa_vector<Real>& ranks) const {
+  const unsigned int num_threads = plan_threads_;
+  const size_t N = ranks.size();
+  if (history.size() == 2) { // Aitken
+    numa_vector<Real>& x0 = history[0];
+    const numa_vector<Real>& x1 = history[1];
+    parallel_run(num_threads, [&](unsigned int t) {
+      size_t last = partition_begin(N, num_threads, t+1);
+      for (size_t i = partition_begin(N, num_threads, t); i < last; ++i) {
+	double d1 = (double) x1[i] - x0[i], d2 = (double) ranks[i] - x1[i];
+	double denom = d2 - d1;
+	x0[i] = (fabs(denom) > 1e-300)? ranks[i] - d2 * d2 / denom : ranks[i];
+      }
+    });
+    return true;
+  }
+
+  // Quadratic : normal equations of the least squares fit
+  numa_vector<Real>& x0 = history[0];
+  const numa_vector<Real>& x1 = history[1];
+  const numa_vector<Real>& x2 = history[2];
+  vector<vector<double> > sums( num_threads, vector<double>( 5, 0.0));
+  parallel_run(num_threads, [&](unsigned int t) {
+    vector<double>& s = sums[t];
+    size_t last = partition_begin(N, num_threads, t+1);
+    for (size_t i = partition_begin(N, num_threads, t); i < last; ++i) {
+      double dk = (double) ranks[i] - x2[i], d1 = (double) x2[i] - x1[i], d2 = (double) x1[i] - x0[i];
+      s[0] += d1 * d1; s[1] += d1 * d2; s[2] += d2 * d2;
+      s[3] += d1 * dk; s[4] += d2 * dk;
+    }
+  });
+  for (unsigned int t = 1; t < num_threads; ++t) {
+    for (int j = 0; j < 5; ++j) sums[0][j] += sums[t][j];
+  }
+  const vector<double>& s = sums[0];
+  double det = s[0] * s[2] - s[1] * s[1];
+  if (!(det > 1e-12 * s[0] * s[2])) return false; // (nearly) collinear differences
+  double a1 = -(s[3] * s[2] - s[4] * s[1]) / det;
+  double a2 = -(s[0] * s[4] - s[1] * s[3]) / det;
+  double norm = 1.0 + a1 + a2;
+  if (fabs(norm) < 1e-6) return false;
+  parallel_run(num_threads, [&](unsigned int t) {
+    size_t last = partition_begin(N, num_threads, t+1);
+    for (size_t i = partition_begin(N, num_threads, t); i < last; ++i) {
+      x0[i] = (ranks[i] + a1 * x2[i] + a2 * x1[i]) / norm;
+    }
+  });
+  return true;
+}
+
+template<typename Real>
+rank_type PageRank::max_change(const numa_vector<Real>& new_ranks, const numa_vector<Real>& old_ranks) const {
+  rank_type change = 0.0;
+  for (size_t i = 0; i < new_ranks.size(); ++i) {
+    change = std::max(change, (rank_type) fabs((rank_type) new_ranks[i] - old_ranks[i]));
+  }
+  return change;
+}
+
+// Float ranks for PRECISION_AUTO : only for large networks (where the memory
+// traffic matters) and when the convergence check does not ask for more than
+// float can resolve for ranks of the order of 1/N
+bool PageRank::use_float() const {
+  switch (precision_) {
+  case PRECISION_FLOAT :
+    return true;
+  case PRECISION_DOUBLE :
+    return false;
+  default :
+    return num_nodes_ >= FLOAT_AUTO_MIN_NODES &&
+      (epsilon_ == NO_CONVERGENCE_CHECK || epsilon_ * num_nodes_ >= FLOAT_AUTO_MIN_EPSILON);
+  }
+}
+
+// computes PageRanks for several decay factors at once
+// ranks[v] receives the PageRanks for decays[v], indexed in unique ID of the Network Nodes.
+// The decay factor is not part of the link structure, so all rank vectors are
+// advanced together in a single pass over the links per iteration: the ranks
+// of one node for all decay factors are interleaved (ranks of node i at 
+// [i*K .. i*K+K) ) and each link is loaded once for the K vectors.
+// Each rank vector is checked for convergence on its own; once converged it
+// is copied out and dropped from the interleaved ranks, so the later passes
+// only scale and load the ranks still iterated. The iteration stops when all
+// of them converged.
+// Complexity : O (I x (N + E) x K)
+void PageRank::calculate_PageRanks(const vector<rank_type>& decays, 
+				   vector<vector<rank_type> >& ranks) {
+
+  PRINT(LOG_LVL_2, "Calculation Parameters : " << endl
+	<< "decay factors = " ); 
+  for (size_t v = 0; v < decays.size(); ++v) {
+    PRINT(LOG_LVL_2, decays[v] << " ");
+  }
+  PRINT(LOG_LVL_2, endl << "iterations    = " << iterations_ << endl
+  	<< "epsilon       = " << epsilon_ 
+	<< ((epsilon_ == NO_CONVERGENCE_CHECK)? " <no_converevence_check>" : "") << endl );
+  {
+    PerfScope perf("build", num_edges_);
+    build_in_links();
+  }
+  with_in_links([&](const auto& links) { sweep_iteration(links, decays, ranks); });
+}
+
+template<typename Index>
+void PageRank::sweep_iteration(const CompressedGraph<Index>& links, const vector<rank_type>& decays,
+			       vector<vector<rank_type> >& ranks) {
+  const size_t K = decays.size();
+  ranks.assign( K, vector<rank_type>( num_nodes_));
+  // lane v of the interleaved ranks holds the ranks for decays[lanes[v]]
+  vector<size_t> lanes( K);
+  vector<rank_type> lane_decay( decays), rank_const( K); // (1-d)/N for each lane
+  for (size_t v = 0; v < K; ++v) {
+    lanes[v] = v;
+    rank_const[v] = (1 - decays[v]) / num_nodes_;
+  }
+  size_t L = K; // lanes, ie. rank vectors not yet converged
+  numa_vector<rank_type> cur_ranks( num_nodes_ * K);
+  numa_vector<rank_type> new_ranks( num_nodes_ * K);
+  numa_vector<rank_type> scaled( num_nodes_ * K); // PR(j)/L(j) for all the lanes
+  const unsigned int num_threads = threads_;
+  parallel_run(num_threads, [&](unsigned int t) { // first touch by the worker of the rows
+    size_t last = links.node_partition(num_threads, t+1) * K;
+    for (size_t j = links.node_partition(num_threads, t) * K; j < last; ++j) {
+      cur_ranks[j] = 1.0/num_nodes_; // initial rank = 1/N
+      new_ranks[j] = scaled[j] = 0.0;
+    }
+  });
+
+  vector<vector<rank_type> > max_diff( num_threads, vector<rank_type>( K));
+  vector<char> converged( K);
+  PRINT(LOG_LVL_2, "Performing power iteration..." << endl);
+  for (unsigned int k=0; k < iterations_ && L; ++k) {
+    PRINT(LOG_LVL_2, "Iteration #" << k+1 << endl);
+    PerfScope perf("sweep", links.num_links(), k+1);
+
+    parallel_run(num_threads, [&](unsigned int t) {
+      size_t first = links.node_partition(num_threads, t) * L;
+      size_t last = links.node_partition(num_threads, t+1) * L;
+      for (size_t j = first; j < last; ++j) {
+	scaled[j] = cur_ranks[j] * links.out_weight_[j / L];
+      }
+    });
+    parallel_run(num_threads, [&](unsigned int t) {
+      vector<rank_type> sum( L);
+      vector<rank_type>& diff = max_diff[t];
+      fill(diff.begin(), diff.end(), 0.0);
+      Index last = links.row_partition(num_threads, t+1);
+      for (Index i = links.row_partition(num_threads, t); i < last; ++i) {
+	fill(sum.begin(), sum.end(), 0.0);
+	for (size_t l = links.row_offsets_[i]; l < links.row_offsets_[i+1]; ++l) {
+	  const rank_type* src = &scaled[links.links_[l] * L];
+	  for (size_t v = 0; v < L; ++v) {
+	    sum[v] += src[v];
+	  }
+	}
+	for (size_t v = 0; v < L; ++v) {
+	  size_t pos = i * L + v;
+	  new_ranks[pos] = rank_const[v] + lane_decay[v] * sum[v];
+	  diff[v] = std::max(diff[v], (rank_type) fabs(new_ranks[pos] - cur_ranks[pos]));
+	}
+      }
+    });
+    cur_ranks.swap( new_ranks);
+
+    if (epsilon_ == NO_CONVERGENCE_CHECK) continue;
+    size_t keep = 0;
+    for (size_t v = 0; v < L; ++v) { // check each rank vector for convergence on its own
+      rank_type diff = 0.0;
+      for (unsigned int t = 0; t < num_threads; ++t) {
+	diff = std::max(diff, max_diff[t][v]);
+      }
+      converged[v] = (diff < epsilon_);
+      if (converged[v]) {
+	PRINT(LOG_LVL_2, "PageRanks for decay factor " << decays[lanes[v]] 
+	      << " converged within the given accuracy." << endl);
+      }
+      else {
+	++keep;
+      }
+    }
+    if (keep == L) continue;
+
+    // the converged rank vectors are copied out, and the others packed into
+    // keep lanes : the next sweeps load and scale only the active ranks
+    parallel_run(num_threads, [&](unsigned int t) {
+      Index last = links.node_partition(num_threads, t+1);
+      for (Index i = links.node_partition(num_threads, t); i < last; ++i) {
+	size_t w = i * keep;
+	for (size_t v = 0; v < L; ++v) {
+	  if (converged[v]) ranks[lanes[v]][i] = cur_ranks[i * L + v];
+	  else new_ranks[w++] = cur_ranks[i * L + v];
+	}
+      }
+    });
+    cur_ranks.swap( new_ranks);
+    size_t w = 0;
+    for (size_t v = 0; v < L; ++v) {
+      if (converged[v]) continue;
+      lanes[w] = lanes[v];
+      lane_decay[w] = lane_decay[v];
+      rank_const[w] = rank_const[v];
+      ++w;
+    }
+    L = keep;
+  }
+
+  for (node_id_type i = 0; i < num_nodes_; ++i) { // the lanes left at the end of the iterations
+    for (size_t v = 0; v < L; ++v) {
+      ranks[lanes[v]][i] = cur_ranks[i * L + v];
+    }
+  }
+}
+
+// computes the scores of several vertex programs on one link structure
+// The programs on the network as it is run first, then the ones which need the
+// rank leaks fixed (PageRank), on a link structure built with the fix.
+// Complexity : O (I x P x (N + E)) per program, P being its number of phases
+void PageRank::calculate_scores(const vector<const VertexProgram*>& programs, 
+				vector<vector<rank_type> >& scores) {
+  PRINT(LOG_LVL_2, "Calculation Parameters : " << endl
+	<< "iterations   = " << iterations_ << endl
+  	<< "epsilon      = " << epsilon_ 
+	<< ((epsilon_ == NO_CONVERGENCE_CHECK)? " <no_converevence_check>" : "") << endl );
+  vector<size_t> first( programs.size()); // first score vector of each program
+  size_t num_scores = 0;
+  for (size_t p = 0; p < programs.size(); ++p) {
+    first[p] = num_scores;
+    num_scores += programs[p]->num_scores();
+  }
+  scores.resize( num_scores);
+  for (int fixed = 0; fixed < 2; ++fixed) {
+    bool built = false;
+    for (size_t p = 0; p < programs.size(); ++p) {
+      if (programs[p]->leaks_fixed() != (bool) fixed) continue;
+      if (!built) {
+	build_in_links( fixed);
+	built = true;
+      }
+      with_in_links([&](const auto& links) {
+	typedef typename std::decay<decltype(links)>::type::index_type index_type;
+	VertexIteration<index_type> iteration(links, threads_);
+	vector<vector<rank_type> > program_scores;
+	unsigned int k = iteration.run(*programs[p], iterations_, epsilon_, program_scores);
+	PRINT(LOG_LVL_2, programs[p]->name() << " : " << k << " iterations" << endl);
+	for (size_t s = 0; s < program_scores.size(); ++s) {
+	  scores[first[p] + s].swap( program_scores[s]);
+	}
+      });
+    }
+  }
+}
+
+// Prepare the link structure for the PageRank computation
+// 1. Fix leak nodes - a leak node links to ALL the nodes pointing to it
+// 2. Build the transposed links (CSR) with the transfer factors 1/L, with 32-bit
+//    node IDs unless the network has more nodes than 32 bits can count
+// The leak fixing links only exist in the link structure : the Network itself
+// (adj_list_, back_node_set_) is only read, so diagnostics may run on it at
+// the same time. Unless keep_graph_, back_node_set_ is released afterwards,
+// and a later build (recompute, network grown since) finds the back sets of
+// the leak nodes again from adj_list_.
+// Complexity : O(N + E)
+void PageRank::build_in_links(bool fix_leaks) {
+  if (fix_leaks && back_sets_released_) {
+    restore_leak_back_sets();
+  }
+  wide_links_ = (num_nodes_ > std::numeric_limits<unsigned int>::max());
+  in_links_ = CompressedGraph<unsigned int>();
+  wide_in_links_ = CompressedGraph<unsigned long long>();
+  with_in_links([&](auto& links) { fill_in_links(links, fix_leaks); });
+
+  if (fix_leaks && !keep_graph_) {
+    // Free up space used by back_node_set_ vector< set<>> as for the this PageRank tool
+    // the only use of the the back_node_set_ is to perform above step 1. Fix rank sinks
+    // Caution: This invalidate the Network class member back_node_set_ and any operations
+    // depend on it. Hence, not advisable unless really needed to free-up memory
+    release_back_node_sets();
+  }
+}
+
+// back_node_set_ of the rank leaks (the only ones the leak fixing needs) from
+// adj_list_, sources in increasing order : O(N + E)
+void PageRank::restore_leak_back_sets() {
+  PRINT(LOG_LVL_2, "Finding the nodes linking to rank leaks..." << endl);
+  release_back_node_sets(); // sets of edges added since : partial
+  back_node_set_.resize( num_nodes_);
+  for (node_id_type i = 0; i < num_nodes_; ++i) {
+    const neighbor_set_type& out_links = neighbors( i);
+    for (attr_citer iter = out_links.begin(); iter != out_links.end(); ++iter) {
+      if (is_rank_leak( iter->first)) {
+	back_neighbor_set_type& back_nodes = back_node_set_[iter->first];
+	back_nodes.insert( back_nodes.end(), i);
+      }
+    }
+  }
+}
+
+// outbound links of node j in the link structure : its links, or for a rank
+// leak with fix_leaks the nodes linking to it
+// Ref. Arvind A. et al. Searching the Web, pp 33 : footnote 8 (Alternative solution)
+template<typename Func>
+inline void PageRank::for_each_out_link(node_id_type j, bool fix_leaks, Func func) const {
+  const neighbor_set_type& out_links = neighbors( j);
+  if (!out_links.empty() || !fix_leaks) {
+    for (attr_citer iter = out_links.begin(); iter != out_links.end(); ++iter) {
+      func(iter->first, out_links.size());
+    }
+  }
+  else if (j < back_node_set_.size()) {
+    const back_neighbor_set_type& back_nodes = back_node_set_[j];
+    for (back_neighbor_citer bn = back_nodes.begin(); bn != back_nodes.end(); ++bn) {
+      func(*bn, back_nodes.size());
+    }
+  }
+}
+
+// Transpose the adjacency list into CSR rows : links row i <==> adj_list_[.][i]
+// Normalization (1/L) is kept per source node, the decay factor is left to the solver
+template<typename Index>
+void PageRank::fill_in_links(CompressedGraph<Index>& links, bool fix_leaks) {
+  if (fix_leaks) {
+    PRINT(LOG_LVL_2, "Fixing rank leak nodes..." << endl);
+  }
+  PRINT(LOG_LVL_2, "Building the transposed link structure..." << endl);
+  links.out_weight_.resize( num_nodes_);
+  links.row_offsets_.assign( num_nodes_ + 1, 0);
+  edge_count_type edges_added = 0;
+  for (node_id_type j = 0; j < num_nodes_; ++j) { // count in-links of each node
+    for_each_out_link(j, fix_leaks, [&](node_id_type i, size_t) { ++links.row_offsets_[i + 1]; });
+    if (fix_leaks && is_rank_leak( j) && j < back_node_set_.size()) {
+      PRINT(LOG_LVL_3, "For node " <<  node( j) << " : "
+	    << back_node_set_[j].size() << " leak fixing link(s)" << endl);
+      edges_added += back_node_set_[j].size();
+    }
+  }
+  if (fix_leaks && edges_added) {
+    PRINT(LOG_LVL_2, edges_added << " Edges were aded to fix leak nodes." << endl);
+  }
+  else if (fix_leaks) {
+    PRINT(LOG_LVL_2, "There were no rank leaks to fix" << endl);    
+  }
+  std::partial_sum(links.row_offsets_.begin(), links.row_offsets_.end(), 
+		   links.row_offsets_.begin());
+  links.links_.resize( links.row_offsets_[num_nodes_]);
+
+  // NUMA mode : place each part of the arrays on the node of the worker sweeping its rows
+  const unsigned int num_threads = threads_;
+  auto rows = [&](unsigned int t) -> size_t { return links.row_partition(num_threads, t); };
+  place_partitions( links.row_offsets_, num_threads, [&](unsigned int t) { 
+      return (t < num_threads)? rows(t) : links.row_offsets_.size(); });
+  first_touch( links.out_weight_, num_threads, rows);
+  first_touch( links.links_, num_threads, [&](unsigned int t) { return links.row_offsets_[rows(t)]; });
+
+  vector<size_t> fill_pos( links.row_offsets_.begin(), links.row_offsets_.end() - 1);
+  for (node_id_type j = 0; j < num_nodes_; ++j) { // sources in increasing order within a row
+    links.out_weight_[j] = 0.0;
+    for_each_out_link(j, fix_leaks, [&](node_id_type i, size_t num_out_links) {
+	links.out_weight_[j] = 1.0 / num_out_links;
+	links.links_[fill_pos[i]++] = j;
+      });
+  }
+}
+
+// One power iteration step : new_ranks = d * [A]T * ranks + rank_const
+// Each rank is first divided by the number of outbound links of its node, so
+// that the sweep over the in-links is a plain sum (accumulated in double
+// whatever the storage precision Real) done by sweep_rows(). The rows
+// are split over plan_threads_ threads with balanced number of links.
+// Complexity : O(N + E)
+template<typename Real, typename Index>
+void PageRank::pull_sweep(const CompressedGraph<Index>& links, const numa_vector<Real>& ranks,
+			  numa_vector<Real>& new_ranks, numa_vector<Real>& scaled,
+			  rank_type decay, rank_type rank_const) {
+  const unsigned int num_threads = plan_threads_;
+  parallel_run(num_threads, [&](unsigned int t) {
+    Index last = links.node_partition(num_threads, t+1);
+    for (Index j = links.node_partition(num_threads, t); j < last; ++j) {
+      scaled[j] = ranks[j] * links.out_weight_[j]; // PR(j)/L(j)
+    }
+  });
+  parallel_run(num_threads, [&](unsigned int t) {
+    sweep_rows<Real, Index>(links, scaled.data(), new_ranks.data(), links.row_partition(num_threads, t),
+	       links.row_partition(num_threads, t+1), decay, rank_const);
+  });
 }
 
 // small predicate for convergence test : |new_rank - old_rank| < e
@@ -418,12 +1439,13 @@ struct CompEpsilon {
 };
 
 // indicate whether the PageRanks have converged within the given accuracy, epsilon
-bool PageRank::is_converged(vector<rank_type>& new_ranks, vector<rank_type>& old_ranks, 
+template<typename Real>
+bool PageRank::is_converged(const numa_vector<Real>& new_ranks, const numa_vector<Real>& old_ranks, 
 			    rank_type epsilon) const {
   return equal(new_ranks.begin(), new_ranks.end(), old_ranks.begin(), CompEpsilon( epsilon));
 }
 
 // rank leak : no outbound edges 
 inline bool PageRank::is_rank_leak(node_id_type id) const { 
-  return adj_list_[id].empty() ; 
+  return neighbors( id).empty() ; 
 }  
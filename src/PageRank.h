@@ -25,6 +25,9 @@
 #define PAGERANK_PAGERANK_CLASS
 
 #include "Network.h"
+#include "CompressedGraph.h"
+#include "SweepKernels.h"
+#include "VertexProgram.h"
 
 // PageRank class - Derived class of a generic Network class which provides 
 // facilities to calculate PageRank of the Network. This class also provides
@@ -36,12 +39,105 @@ public:
 	   unsigned int growth_rate=DEFAULT_GROWTH_RATE); // ctor
   // ~PageRank(); // dtor - default is OK
 
+  // calculation parameters of other (decay, iterations, epsilon, growth rate
+  // and what the set_...() methods below set but the progress callback and
+  // the warm start), to be called before any node is added
+  void copy_parameters(const PageRank& other);
+
   // Diagonastic :
-  bool find_rank_leaks(vector<Node>& leaks);
-  bool find_rank_sinks(vector<vector<Node> >& sinks );
+  // The Network is only read : they may run while the PageRanks are computed
+  // on another thread if set_keep_graph(true) was called
+  bool find_rank_leaks(vector<Node>& leaks) const;
+  bool find_rank_sinks(vector<vector<Node> >& sinks ) const;
+
+  // Storage precision of the ranks in the solver. Float ranks halve the memory
+  // traffic of the sweep (sums are still accumulated in double).
+  // PRECISION_AUTO uses float for large networks when epsilon allows it
+  // (default : PRECISION_DOUBLE).
+  typedef enum { PRECISION_AUTO, PRECISION_FLOAT, PRECISION_DOUBLE } ePrecision;
+  void set_precision(ePrecision precision) { precision_ = precision; }
+
+  // Solver of calculate_PageRanks() :
+  // SOLVER_POWER - power iteration over the whole network
+  // SOLVER_SCC   - strongly connected components solved one by one, upstream
+  //                components first, each to its own convergence
+  // SOLVER_GMRES, SOLVER_BICGSTAB - Krylov solvers of the linear system
+  //                (I - d P^T) x = (1-d)/N, see KrylovSolver.h
+  // SOLVER_DELTA - delta-PageRank : only rank changes are propagated, by push
+  //                or pull rounds, see DeltaSolver.h
+  // SOLVER_AUTO  - chosen by the execution planner (see make_plan())
+  typedef enum { SOLVER_POWER, SOLVER_SCC, SOLVER_GMRES, SOLVER_BICGSTAB, SOLVER_DELTA,
+		 SOLVER_AUTO } eSolver;
+  void set_solver(eSolver solver) { solver_ = solver; }
+  // Jacobi preconditioning of the Krylov solvers
+  void set_jacobi(bool jacobi) { jacobi_ = jacobi; }
+
+  // Extrapolation of the power iteration every EXTRAPOLATION_PERIOD steps :
+  // EXTRAPOLATE_AITKEN    - Aitken delta^2 on each rank, from the last 3 iterates
+  // EXTRAPOLATE_QUADRATIC - quadratic extrapolation from the last 4 iterates
+  typedef enum { EXTRAPOLATE_NONE, EXTRAPOLATE_AITKEN, EXTRAPOLATE_QUADRATIC } eExtrapolation;
+  void set_extrapolation(eExtrapolation extrapolation) { extrapolation_ = extrapolation; }
+
+  // Initial ranks of the power iteration :
+  // INIT_UNIFORM   - 1/N for all nodes
+  // INIT_BLOCKRANK - local PageRank within the host of each node (from its
+  //                  URL) times the PageRank of the host in the host graph
+  typedef enum { INIT_UNIFORM, INIT_BLOCKRANK } eInitialRanks;
+  void set_initial_ranks(eInitialRanks init) { init_ = init; }
+
+  // Stable top-K termination of the power iteration : stop once the k best
+  // ranked nodes (set and order) have not changed for patience iterations,
+  // even if epsilon is not reached. The residual (max change of the last
+  // iteration) is logged. k = 0 : off.
+  void set_stable_top(unsigned int k, unsigned int patience) { stable_top_ = k; patience_ = patience; }
+
+  // The solvers only read the Network, and release back_node_set_ once their
+  // link structure is built, unless the graph is kept for other readers. A
+  // later calculate_PageRanks() finds the nodes linking to each rank leak
+  // again from the adjacency list (O(N + E)) : it gives the same ranks.
+  void set_keep_graph(bool keep) { keep_graph_ = keep; }
+
+  // Warm start : the power iteration, Krylov and delta solvers start from the
+  // PageRanks of the previous calculate_PageRanks() call, for a network grown
+  // since (snapshots of an edge stream). Nodes added since start at 1/N.
+  void set_warm_start(bool warm) { warm_start_ = warm; }
+  // warm start from ranks by node ID, eg. of a network this one was rebuilt
+  // from with its nodes first in the same order
+  void set_warm_start(const vector<rank_type>& ranks) { warm_start_ = true; page_ranks_ = ranks; }
+
+  // Execution planner : calculate_PageRanks() plans the solve once the link
+  // structure is built. With SOLVER_AUTO or auto threads it collects graph
+  // and machine statistics (GraphStats.h) and picks what was left to it :
+  // the solver, the rank precision (PRECISION_AUTO) and the number of
+  // threads for the solve (at most the cores). The plan and its reasons are
+  // logged at level 2.
+  void set_auto_threads(bool auto_threads) { auto_threads_ = auto_threads; }
+  // threads of the calculations (default : Parallel::num_threads_ when the
+  // object was built), the plan may use fewer with auto threads. Each object
+  // keeps its own count, so calculations on different objects may run at
+  // the same time with different counts.
+  void set_threads(unsigned int num_threads) { threads_ = std::max(num_threads, 1u); }
+  // build the link structure and plan, without solving (--explain)
+  void plan_PageRanks();
+  // plan of the last calculate_PageRanks() or plan_PageRanks()
+  const string& plan() const { return plan_; }
+
+  // Progress of calculate_PageRanks(), on the calling thread : after each
+  // iteration of the power iteration, sweep of the Krylov solvers, round of
+  // the delta solver, or level of components of SOLVER_SCC (change 0, their
+  // ranks are final). Returning false stops the solver : the ranks are then
+  // those of the last step, not converged.
+  void set_progress(const ProgressCallback& progress) { progress_ = progress; }
 
   // Computation :
   const vector<rank_type>& calculate_PageRanks();
+  // PageRanks for several decay factors in one pass per iteration
+  void calculate_PageRanks(const vector<rank_type>& decays, vector<vector<rank_type> >& ranks);
+  // Link analysis scores of vertex programs (VertexProgram.h) on one link
+  // structure, with the iterations and epsilon of this object. scores
+  // receives the score vectors of the programs, in order.
+  void calculate_scores(const vector<const VertexProgram*>& programs, 
+			vector<vector<rank_type> >& scores);
 
 private:
   // PageRank scores calculated for each node
@@ -50,16 +146,119 @@ private:
   rank_type decay_factor_ ;
   unsigned int iterations_;
   rank_type epsilon_;
+  ePrecision precision_;
+  eSolver solver_;
+  bool jacobi_;
+  eExtrapolation extrapolation_;
+  eInitialRanks init_;
+  unsigned int stable_top_, patience_;
+  bool keep_graph_;
+  bool warm_start_;
+  ProgressCallback progress_;
+  bool auto_threads_;
+  unsigned int threads_;
+
+  // plan of the solve (make_plan()) : solver, float ranks, threads and why
+  eSolver plan_solver_;
+  bool plan_float_;
+  unsigned int plan_threads_;
+  string plan_;
+
+  // Transposed link structure (with leaks fixed) used by the solvers
+  // with 32-bit node IDs, or 64-bit IDs for networks of more than 2^32 nodes
+  CompressedGraph<unsigned int> in_links_;
+  CompressedGraph<unsigned long long> wide_in_links_;
+  bool wide_links_; // wide_in_links_ is in use
 
   // Helpers :
+  // build in_links_ (or wide_in_links_), with the rank leaks fixed unless
+  // fix_leaks is false
+  void build_in_links(bool fix_leaks=true);
+  // back_node_set_ of the rank leaks, once it was released
+  void restore_leak_back_sets();
+  template<typename Index>
+  void fill_in_links(CompressedGraph<Index>& links, bool fix_leaks);
+  // call func(i, L) for each outbound link j -> i of the link structure, L
+  // being the number of these links
+  template<typename Func>
+  void for_each_out_link(node_id_type j, bool fix_leaks, Func func) const;
+
+  // call func with the link structure filled by build_in_links()
+  template<typename Func>
+  void with_in_links(Func func) { if (wide_links_) func(wide_in_links_); else func(in_links_); }
+
+  // whether the solver keeps the ranks in float
+  bool use_float() const;
+
+  // plan the solve on links (plan_solver_, plan_float_, plan_threads_, plan_)
+  template<typename Index>
+  void make_plan(const CompressedGraph<Index>& links);
+  // working memory (bytes) of a solver, on top of the link structure
+  size_t solver_memory(eSolver solver, bool float_ranks) const;
+
+  // power iteration on the ranks stored as Real, result in page_ranks_
+  template<typename Real, typename Index>
+  void power_iteration(const CompressedGraph<Index>& links);
+
+  // one power iteration step : new_ranks = decay * [A]T * ranks + rank_const
+  // (rows are summed by sweep_rows(), see SweepKernels.h)
+  template<typename Real, typename Index>
+  void pull_sweep(const CompressedGraph<Index>& links, const numa_vector<Real>& ranks,
+		  numa_vector<Real>& new_ranks, numa_vector<Real>& scaled,
+		  rank_type decay, rank_type rank_const);
+
+  // warm start ranks (set_warm_start()) : the previous PageRanks scaled by
+  // (previous N)/N, new nodes at 1/N. Returns false, seed untouched, if
+  // there are no previous PageRanks to start from.
+  bool warm_start_ranks(vector<rank_type>& seed) const;
+
+  // BlockRank initial ranks (INIT_BLOCKRANK), returns false if the network
+  // has no host structure to use
+  template<typename Index>
+  bool block_rank_seed(const CompressedGraph<Index>& links, vector<rank_type>& seed) const;
+
+  // Strongly connected components of links : comp_of[i] is the component of
+  // node i, components are numbered in topological order (upstream first) and
+  // the nodes of component c are members[comp_begin[c] .. comp_begin[c+1])
+  template<typename Index>
+  void find_components(const CompressedGraph<Index>& links, vector<Index>& comp_of,
+		       vector<Index>& members, vector<size_t>& comp_begin) const;
+
+  // PageRanks solved component by component (SOLVER_SCC), result in page_ranks_
+  template<typename Index>
+  void component_iteration(const CompressedGraph<Index>& links);
+
+  // PageRanks by a Krylov solver (SOLVER_GMRES/SOLVER_BICGSTAB), result in page_ranks_
+  template<typename Index>
+  void krylov_solve(const CompressedGraph<Index>& links);
+
+  // PageRanks by delta-PageRank (SOLVER_DELTA), result in page_ranks_
+  template<typename Index>
+  void delta_solve(const CompressedGraph<Index>& links);
+
+  // power iteration for several decay factors (see calculate_PageRanks())
+  template<typename Index>
+  void sweep_iteration(const CompressedGraph<Index>& links, const vector<rank_type>& decays,
+		       vector<vector<rank_type> >& ranks);
+
   // indicate whether a given node is rank leak
   bool is_rank_leak(node_id_type id) const ;  
 
   // merge a new_rank sink with a one of the exsisting rank sinks if possible
   bool merge_rank_sinks(vector<vector<Node> >& sinks, vector<Node>& new_sink) const;
 
+  // extrapolate from the iterates history[0..] (oldest first) and ranks (the
+  // newest one), result in history[0]. Returns false if the iterates don't
+  // allow an extrapolation.
+  template<typename Real>
+  bool extrapolate(vector<numa_vector<Real> >& history, const numa_vector<Real>& ranks) const;
+  // max |new_ranks - old_ranks|
+  template<typename Real>
+  rank_type max_change(const numa_vector<Real>& new_ranks, const numa_vector<Real>& old_ranks) const;
+
   // indicate whether the PageRanks have converged to given accuracy, epsilon
-  bool is_converged(vector<rank_type>& new_ranks, vector<rank_type>& old_ranks, 
+  template<typename Real>
+  bool is_converged(const numa_vector<Real>& new_ranks, const numa_vector<Real>& old_ranks, 
 		    rank_type epsilon) const ;
 
   // Node type for rank sink classification in the find_rank_sinks()
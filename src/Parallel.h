@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2012 Chammika Mannakkara
+ *
+ *    Parallel.h - Minimal fork/join helpers over std::thread used by the
+ *                 concurrent parts of the tool
+ *
+ *    This is a part of simple tool calculate the PageRank
+ *
+ *    This source code is free software; you can redistribute it
+ *    and/or modify it in source code form under the terms of the GNU
+ *    General Public License as published by the Free Software
+ *    Foundation; either version 2 of the License, or (at your option)
+ *    any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+#ifndef PAGERANK_PARALLEL
+#define PAGERANK_PARALLEL
+
+#include <thread>
+#include <cstddef>
+
+#include "types.h"
+#include "Numa.h"
+
+struct Parallel { // class Parallel public:
+  // number of worker threads used by the build and solve phases (-t option)
+  static unsigned int num_threads_;
+};
+
+// Run func(t) on num_threads threads, t = 0 .. num_threads-1, and wait for
+// all of them. Thread 0 is the calling thread, so num_threads == 1 costs
+// nothing more than a plain function call.
+// In NUMA mode the same t always runs on the same core, so memory first
+// touched by worker t stays local to worker t in later calls. The calling
+// thread gets its own affinity back on return.
+template<typename Func>
+void parallel_run(unsigned int num_threads, Func func) {
+  if (num_threads <= 1) {
+    func(0u);
+    return;
+  }
+  // NUMA mode : each worker runs on its own core (see Numa.h)
+  auto worker = [&func, num_threads](unsigned int t) {
+    if (Numa::enabled_) Numa::pin_thread(t, num_threads);
+    func(t);
+  };
+  vector<std::thread> workers;
+  workers.reserve( num_threads - 1);
+  for (unsigned int t = 1; t < num_threads; ++t) {
+    workers.push_back( std::thread(worker, t));
+  }
+  {
+    SavedAffinity saved( Numa::enabled_); // worker 0 is the calling thread
+    worker(0u);
+  }
+  for (unsigned int t = 0; t < workers.size(); ++t) {
+    workers[t].join();
+  }
+}
+
+// Static partitioning of the range [0, n) into num_parts contiguous parts.
+// Returns the first index of part 'part' ( part == num_parts gives n )
+inline size_t partition_begin(size_t n, unsigned int num_parts, unsigned int part) {
+  return (n / num_parts) * part + std::min<size_t>(part, n % num_parts);
+}
+
+// NUMA mode : resize() of a numa_vector leaves the memory untouched, this
+// writes T() to elements part(t) .. part(t+1) on worker t, which places them on
+// the node of that worker (part(num_threads) must be v.size())
+template<typename T, typename Part>
+void first_touch(numa_vector<T>& v, unsigned int num_threads, Part part) {
+  if (!Numa::enabled_) return;
+  parallel_run(num_threads, [&](unsigned int t) {
+    std::fill(v.begin() + part(t), v.begin() + part(t+1), T());
+  });
+}
+
+// NUMA mode : as first_touch() for an array which already holds data, by
+// copying it to fresh memory
+template<typename T, typename Part>
+void place_partitions(numa_vector<T>& v, unsigned int num_threads, Part part) {
+  if (!Numa::enabled_) return;
+  numa_vector<T> placed( v.size());
+  parallel_run(num_threads, [&](unsigned int t) {
+    std::copy(v.begin() + part(t), v.begin() + part(t+1), placed.begin() + part(t));
+  });
+  v.swap( placed);
+}
+
+#endif
@@ -0,0 +1,189 @@
+/*
+ * Copyright (c) 2012 Chammika Mannakkara
+ *
+ *    PerfCounters.cpp - Implementation of the performance counters
+ *
+ *    This is a part of simple tool calculate the PageRank
+ *
+ *    This source code is free software; you can redistribute it
+ *    and/or modify it in source code form under the terms of the GNU
+ *    General Public License as published by the Free Software
+ *    Foundation; either version 2 of the License, or (at your option)
+ *    any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+#include <cerrno>
+#include <cstring>
+#include <mutex>
+#include <sstream>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "PerfCounters.h"
+#include "Log.h"
+
+// file descriptors of the counters, -1 if not available
+static int counter_fd[PerfCounters::NUM_COUNTERS] = { -1, -1, -1, -1, -1 };
+static std::once_flag counters_opened;
+static bool any_counter = false;
+
+// counts of a phase
+struct PerfRecord {
+  string phase;
+  unsigned int iteration;
+  edge_count_type edges;
+  double seconds;
+  double counts[PerfCounters::NUM_COUNTERS];
+};
+static vector<PerfRecord> records;
+static std::mutex records_lock; // phases may run on several threads (analyze mode)
+
+const char* PerfCounters::name(eCounter counter) {
+  static const char* names[NUM_COUNTERS] = { "cycles", "instructions", "LLC misses",
+					     "dTLB misses", "branch misses" };
+  return names[counter];
+}
+
+// column of a counter in the CSV export
+static const char* column(PerfCounters::eCounter counter) {
+  static const char* columns[PerfCounters::NUM_COUNTERS] = { "cycles", "instructions", "llc_misses",
+							     "dtlb_misses", "branch_misses" };
+  return columns[counter];
+}
+
+static int open_counter(unsigned int type, unsigned long long config) {
+  perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = type;
+  attr.config = config;
+  attr.exclude_kernel = 1; // allowed with perf_event_paranoid <= 2
+  attr.exclude_hv = 1;
+  attr.inherit = 1; // threads started later are counted too
+  attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+  return syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0); // this process, any CPU
+}
+
+bool PerfCounters::open() {
+  std::call_once(counters_opened, [] {
+    const unsigned long long read_miss = (PERF_COUNT_HW_CACHE_OP_READ << 8)
+      | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    counter_fd[CYCLES] = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+    counter_fd[INSTRUCTIONS] = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+    counter_fd[LLC_MISSES] = open_counter(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL | read_miss);
+    counter_fd[DTLB_MISSES] = open_counter(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | read_miss);
+    counter_fd[BRANCH_MISSES] = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+    int error = errno;
+    for (unsigned int c = 0; c < NUM_COUNTERS; ++c) {
+      if (counter_fd[c] >= 0) {
+	any_counter = true;
+      }
+      else {
+	PRINT(LOG_LVL_2, "Performance counter not available : " << name((eCounter) c) << endl);
+      }
+    }
+    if (!any_counter) {
+      PRINT(LOG_LVL_2, "No performance counters (" << strerror(error)
+	    << "), only the time of the phases is recorded" << endl);
+    }
+  });
+  return any_counter;
+}
+
+void PerfCounters::read(double values[NUM_COUNTERS]) {
+  for (unsigned int c = 0; c < NUM_COUNTERS; ++c) {
+    unsigned long long data[3]; // value, time enabled, time running
+    if (counter_fd[c] < 0 || ::read(counter_fd[c], data, sizeof(data)) != sizeof(data)) {
+      values[c] = -1.0;
+      continue;
+    }
+    // the counter may have been multiplexed with other events : scale it up
+    values[c] = (data[2] && data[2] < data[1])? (double) data[0] * data[1] / data[2] : data[0];
+  }
+}
+
+bool PerfCounters::export_csv(const string& path) {
+  ofstream out( path.c_str());
+  if (!out) {
+    ERROR("Couldn't write the performance counters to " << path << endl);
+    return false;
+  }
+  out << "phase,iteration,edges,seconds";
+  for (unsigned int c = 0; c < NUM_COUNTERS; ++c) {
+    out << ',' << column((eCounter) c);
+  }
+  for (unsigned int c = 0; c < NUM_COUNTERS; ++c) {
+    out << ',' << column((eCounter) c) << "_per_edge";
+  }
+  out << '\n';
+  std::lock_guard<std::mutex> lock( records_lock);
+  for (const PerfRecord& r : records) {
+    out << r.phase << ',' << r.iteration << ',' << r.edges << ',' << r.seconds;
+    for (unsigned int c = 0; c < NUM_COUNTERS; ++c) { // empty : not available
+      out << ',';
+      if (r.counts[c] >= 0) out << (unsigned long long) r.counts[c];
+    }
+    for (unsigned int c = 0; c < NUM_COUNTERS; ++c) {
+      out << ',';
+      if (r.counts[c] >= 0 && r.edges) out << r.counts[c] / r.edges;
+    }
+    out << '\n';
+  }
+  return (bool) out;
+}
+
+PerfScope::PerfScope(const char* phase, edge_count_type edges, unsigned int iteration)
+  : phase_(phase), edges_(edges), iteration_(iteration) {
+  if (!PerfCounters::enabled_) return;
+  PerfCounters::open();
+  start_time_ = std::chrono::steady_clock::now();
+  PerfCounters::read( start_);
+}
+
+PerfScope::~PerfScope() {
+  if (!PerfCounters::enabled_) return;
+  PerfRecord r;
+  PerfCounters::read( r.counts);
+  r.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time_).count();
+  r.phase = phase_;
+  r.iteration = iteration_;
+  r.edges = edges_;
+  bool any = false;
+  for (unsigned int c = 0; c < PerfCounters::NUM_COUNTERS; ++c) {
+    if (r.counts[c] >= 0 && start_[c] >= 0) {
+      r.counts[c] -= start_[c];
+      any = true;
+    }
+    else {
+      r.counts[c] = -1.0;
+    }
+  }
+  if (any && edges_) { // memory bound sweeps : many cycles and LLC misses per edge, low IPC
+    std::ostringstream line; // one write : phases may end on several threads
+    line << "perf " << phase_;
+    if (iteration_) line << " #" << iteration_;
+    line << " per edge :";
+    const char* separator = " ";
+    for (unsigned int c = 0; c < PerfCounters::NUM_COUNTERS; ++c) {
+      if (r.counts[c] >= 0) {
+	line << separator << r.counts[c] / edges_ << ' ' << PerfCounters::name((PerfCounters::eCounter) c);
+	separator = ", ";
+      }
+    }
+    if (r.counts[PerfCounters::CYCLES] > 0 && r.counts[PerfCounters::INSTRUCTIONS] >= 0) {
+      line << " (IPC " << r.counts[PerfCounters::INSTRUCTIONS] / r.counts[PerfCounters::CYCLES] << ")";
+    }
+    PRINT(LOG_LVL_2, line.str() << endl);
+  }
+  std::lock_guard<std::mutex> lock( records_lock);
+  records.push_back( r);
+}
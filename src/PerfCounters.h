@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2012 Chammika Mannakkara
+ *
+ *    PerfCounters.h - Hardware performance counters (perf_event_open) around
+ *                     the phases and iterations of the solvers
+ *
+ *    This is a part of simple tool calculate the PageRank
+ *
+ *    This source code is free software; you can redistribute it
+ *    and/or modify it in source code form under the terms of the GNU
+ *    General Public License as published by the Free Software
+ *    Foundation; either version 2 of the License, or (at your option)
+ *    any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+#ifndef PAGERANK_PERF_COUNTERS
+#define PAGERANK_PERF_COUNTERS
+
+#include <chrono>
+
+#include "types.h"
+
+// With --perf, cycles, instructions, LLC misses, dTLB misses and branch
+// misses are counted for the process (user space only) around each phase and
+// each iteration of the solvers. The counters are opened once, by the main
+// thread before any worker is started, and inherited by the worker threads :
+// the counts of a worker are added when it exits, ie. at the end of each
+// parallel_run(). Counters the kernel doesn't permit (perf_event_paranoid,
+// virtual machines) are reported as not available, the rest is still counted.
+struct PerfCounters { // class PerfCounters public:
+  typedef enum { CYCLES, INSTRUCTIONS, LLC_MISSES, DTLB_MISSES, BRANCH_MISSES, NUM_COUNTERS } eCounter;
+
+  // counters on (--perf)
+  static bool enabled_;
+
+  // open the counters (once), false if none is available
+  static bool open();
+  // current values, negative for a counter which is not available
+  static void read(double values[NUM_COUNTERS]);
+  static const char* name(eCounter counter);
+
+  // write the records of all the phases to a CSV file (--perf-export)
+  static bool export_csv(const string& path);
+};
+
+// PerfScope - counts one phase (or one iteration of a phase) from its
+// construction to its destruction. The counts are logged per edge and kept
+// for export_csv(). Costs nothing but a test unless PerfCounters::enabled_.
+class PerfScope {
+
+public:
+  // iteration : 0 for a whole phase, k for the k-th iteration
+  PerfScope(const char* phase, edge_count_type edges, unsigned int iteration=0); // ctor
+  ~PerfScope(); // dtor
+
+  // edges processed, if only known at the end of the phase
+  void set_edges(edge_count_type edges) { edges_ = edges; }
+
+private:
+  const char* phase_;
+  edge_count_type edges_;
+  unsigned int iteration_;
+  double start_[PerfCounters::NUM_COUNTERS];
+  std::chrono::steady_clock::time_point start_time_;
+
+  PerfScope( const PerfScope&); // copy ctor -not allowed
+  PerfScope& operator=( const PerfScope&); // assignment operator -not allowed
+};
+
+#endif
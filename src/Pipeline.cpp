@@ -0,0 +1,284 @@
+/*
+ * Copyright (c) 2012 Chammika Mannakkara
+ *
+ *    Pipeline.cpp - Implementation of the staged network ingestion
+ *
+ *    This is a part of simple tool calculate the PageRank
+ *
+ *    This source code is free software; you can redistribute it
+ *    and/or modify it in source code form under the terms of the GNU
+ *    General Public License as published by the Free Software
+ *    Foundation; either version 2 of the License, or (at your option)
+ *    any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+#include <cassert>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "Pipeline.h"
+#include "Log.h"
+
+#define PAGE_ALIGNMENT 4096
+
+// ctor
+// The pool holds enough blocks to fill every queue and keep one block in each
+// stage, so that no stage waits for a buffer while another one has work.
+IngestPipeline::IngestPipeline(InputStream& input, unsigned int num_parsers, size_t block_size,
+			       unsigned int queue_depth)
+  : input_(input), num_parsers_(num_parsers), block_size_(block_size),
+    free_(2 * queue_depth + num_parsers + 2), read_(queue_depth), parsed_(queue_depth),
+    read_error_(false), bytes_read_(0), active_parsers_(0), building_(false), edges_built_(0) {
+
+  assert(num_parsers && block_size && queue_depth && "Pipeline needs non-zero sizes!");
+  blocks_.resize( free_.capacity());
+  for (size_t b = 0; b < blocks_.size(); ++b) {
+    void* buf = 0;
+    if (posix_memalign(&buf, PAGE_ALIGNMENT, block_size_) != 0) {
+      ERROR("Couldn't allocate input buffers" << endl);
+      exit(1);
+    }
+    blocks_[b].data = static_cast<char*>(buf);
+    blocks_[b].text = blocks_[b].data;
+    blocks_[b].size = 0;
+    free_.push( &blocks_[b]);
+  }
+}
+
+// dtor
+IngestPipeline::~IngestPipeline() {
+  for (size_t b = 0; b < blocks_.size(); ++b) {
+    free( blocks_[b].data);
+  }
+}
+
+// Read the network : reader thread -> parser thread(s) -> builder (this thread)
+// Blocks may be parsed out of order, the builder keeps them until their turn.
+bool IngestPipeline::build(Network& net) {
+  start_ = last_report_ = std::chrono::steady_clock::now();
+  building_ = true;
+  active_parsers_ = num_parsers_;
+  std::thread reader(&IngestPipeline::reader_stage, this);
+  vector<std::thread> parsers;
+  for (unsigned int p = 0; p < num_parsers_; ++p) {
+    parsers.push_back( std::thread(&IngestPipeline::parser_stage, this));
+  }
+
+  map<size_t, InputBlock*> waiting; // parsed blocks ahead of their turn
+  size_t next_seq = 0;
+  string src, dst;
+  bool have_src = false; // src is the start of an edge (may end in the next block)
+  InputBlock* block;
+  while (parsed_.pop( block)) {
+    waiting[block->seq] = block;
+    while (!waiting.empty() && waiting.begin()->first == next_seq) {
+      block = waiting.begin()->second;
+      waiting.erase( waiting.begin());
+      for (size_t i = 0; i < block->tokens.size(); ++i) { // tokens paired as by operator>>
+	if (!have_src) {
+	  src.assign( block->tokens[i].data(), block->tokens[i].size());
+	  have_src = true;
+	  continue;
+	}
+	dst.assign( block->tokens[i].data(), block->tokens[i].size());
+	net.add_edge( src, dst);
+	have_src = false;
+	++edges_built_;
+      }
+      free_.push( block); // recycle
+      ++next_seq;
+      report( false);
+    }
+  }
+
+  reader.join();
+  for (unsigned int p = 0; p < parsers.size(); ++p) {
+    parsers[p].join();
+  }
+  report( true);
+  return !read_error_;
+}
+
+// Read the network : reader thread -> builder (this thread). The builder
+// tokenizes each block itself, over num_threads threads, so there is no
+// parser stage. Blocks come in order and the Network is extended in place,
+// so IDs are the same as with build().
+bool IngestPipeline::build_parallel(Network& net, unsigned int num_threads) {
+  start_ = last_report_ = std::chrono::steady_clock::now();
+  building_ = true;
+  const edge_count_type first_edges = net.num_edges();
+  std::thread reader(&IngestPipeline::reader_stage, this);
+  string unpaired; // start of an edge ending in the next block
+  InputBlock* block;
+  while (read_.pop( block)) {
+    net.add_edges_parallel(block->text, block->size, num_threads, unpaired);
+    edges_built_ = net.num_edges() - first_edges;
+    free_.push( block); // recycle
+    report( false);
+  }
+  reader.join();
+  report( true);
+  return !read_error_;
+}
+
+// Read the whole input into one string (reader stage only, for builds that
+// need all of the text in memory)
+bool IngestPipeline::read_all(string& text) {
+  start_ = last_report_ = std::chrono::steady_clock::now();
+  building_ = false;
+  std::thread reader(&IngestPipeline::reader_stage, this);
+  InputBlock* block;
+  while (read_.pop( block)) { // reader emits blocks in order
+    text.append( block->text, block->size);
+    free_.push( block);
+    report( false);
+  }
+  reader.join();
+  report( true);
+  return !read_error_;
+}
+
+// Reader stage : fill free blocks with input text. A block ends at the last
+// line break it holds, the rest of the line is carried to the next block :
+// it is copied just before the first page boundary it fits in front of, and
+// the read goes to that boundary, so reads stay page aligned.
+void IngestPipeline::reader_stage() {
+  string carry; // incomplete last line of the previous block
+  size_t seq = 0;
+  bool eof = false;
+  while (!eof) {
+    InputBlock* block = 0;
+    if (!free_.pop( block)) break;
+    size_t offset = (carry.size() + PAGE_ALIGNMENT - 1) / PAGE_ALIGNMENT * PAGE_ALIGNMENT;
+    if (offset >= block_size_) {
+      ERROR("Input line longer than " << block_size_ - PAGE_ALIGNMENT << " bytes" << endl);
+      read_error_ = true;
+      free_.push( block);
+      break;
+    }
+    char* text = block->data + offset - carry.size();
+    memcpy(text, carry.data(), carry.size());
+    ssize_t len = read_fully(block->data + offset, block_size_ - offset);
+    if (len < 0) {
+      read_error_ = true;
+      free_.push( block);
+      break;
+    }
+    bytes_read_ += len;
+    size_t size = carry.size() + len;
+    eof = (offset + len < block_size_);
+    carry.clear();
+
+    if (!eof) { // cut the block at the last line break
+      size_t end = size;
+      while (end && text[end-1] != '\n') --end;
+      if (!end) {
+	ERROR("Input line longer than " << block_size_ - PAGE_ALIGNMENT << " bytes" << endl);
+	read_error_ = true;
+	free_.push( block);
+	break;
+      }
+      carry.assign(text + end, size - end);
+      size = end;
+    }
+    block->text = text;
+    block->size = size;
+    block->seq = seq++;
+    read_.push( block);
+  }
+  read_.close();
+}
+
+// Parser stage : tokenize blocks into edges
+void IngestPipeline::parser_stage() {
+  InputBlock* block;
+  while (read_.pop( block)) {
+    block->tokens.clear();
+    Network::tokenize(block->text, block->text + block->size, block->tokens);
+    parsed_.push( block);
+  }
+  if (--active_parsers_ == 0) { // last parser out closes the builder's queue
+    parsed_.close();
+  }
+}
+
+// read() until len bytes or end of input
+ssize_t IngestPipeline::read_fully(char* buf, size_t len) {
+  size_t done = 0;
+  while (done < len) {
+    ssize_t n = input_.read(buf + done, len - done);
+    if (n < 0) return -1;
+    if (n == 0) break; // end of input
+    done += n;
+  }
+  return done;
+}
+
+// Progress report : edges, bytes, throughput and the occupancy of the queues
+// in front of each stage (a full queue points at the slow stage behind it)
+void IngestPipeline::report(bool final) {
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  if (!final && now - last_report_ < std::chrono::duration<double>(PROGRESS_REPORT_INTERVAL)) {
+    return;
+  }
+  last_report_ = now;
+  double secs = std::chrono::duration<double>(now - start_).count();
+  double mbytes = bytes_read_ / (1024.0 * 1024.0);
+  double file_mbytes = input_.bytes_read() / (1024.0 * 1024.0); // compressed size
+  if (secs <= 0.0) secs = 1e-9;
+  if (!building_) { // reader stage only
+    PRINT(LOG_LVL_2, mbytes << " MB read in " << secs << " s : " << mbytes / secs << " MB/s"
+	  << (final? "" : " [free buffers ") << (final? "" : std::to_string(free_.size()) + "]") << endl);
+  }
+  else if (final) {
+    PRINT(LOG_LVL_2, edges_built_ << " Edges read (" << mbytes << " MB text, " << file_mbytes 
+	  << " MB file) in " << secs << " s : "
+	  << mbytes / secs << " MB/s, " << edges_built_ / secs << " Edges/s" << endl);
+  }
+  else {
+    PRINT(LOG_LVL_2, edges_built_ << " Edges processed, " << mbytes << " MB read, "
+	  << mbytes / secs << " MB/s, " << edges_built_ / secs << " Edges/s"
+	  << " [parse queue " << read_.size() << "/" << read_.capacity()
+	  << ", build queue " << parsed_.size() << "/" << parsed_.capacity()
+	  << ", free buffers " << free_.size() << "/" << free_.capacity() << "]" << endl);
+  }
+}
+
+void load_network(Network& net, const char* text, size_t length, unsigned int num_threads) {
+  net.add_edges_parallel(text, length, num_threads);
+}
+
+bool load_network(Network& net, int fd, unsigned int num_threads) {
+  std::unique_ptr<InputStream> input = InputStream::open(fd, num_threads);
+  if (!input) {
+    return false;
+  }
+  if (num_threads > 1) { // concurrent build of each block
+    IngestPipeline pipeline(*input, 1, PARALLEL_READ_BLOCK_SIZE, PARALLEL_QUEUE_DEPTH);
+    return pipeline.build_parallel(net, num_threads);
+  }
+  IngestPipeline pipeline( *input);
+  return pipeline.build( net);
+}
+
+bool load_network(Network& net, const string& path, unsigned int num_threads) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    ERROR("Couldn't open the network file : " << path << " (" << strerror(errno) << ")" << endl);
+    return false;
+  }
+  bool loaded = load_network(net, fd, num_threads);
+  close( fd);
+  return loaded;
+}
@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) 2012 Chammika Mannakkara
+ *
+ *    Pipeline.h - Staged network ingestion : reader, parser and builder
+ *                 stages connected by bounded queues
+ *
+ *    This is a part of simple tool calculate the PageRank
+ *
+ *    This source code is free software; you can redistribute it
+ *    and/or modify it in source code form under the terms of the GNU
+ *    General Public License as published by the Free Software
+ *    Foundation; either version 2 of the License, or (at your option)
+ *    any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+#ifndef PAGERANK_PIPELINE_CLASS
+#define PAGERANK_PIPELINE_CLASS
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string_view>
+#include <thread>
+
+#include "Network.h"
+#include "InputStream.h"
+#include "defaults.h"
+
+// BoundedQueue - blocking FIFO of limited capacity connecting two stages.
+// push() blocks while the queue is full (back-pressure on the producer),
+// pop() blocks while it is empty. After close() pop() drains the remaining
+// items and then returns false.
+template<typename T>
+class BoundedQueue {
+public:
+  BoundedQueue(size_t capacity) : capacity_(capacity), closed_(false) { }
+
+  void push(const T& item) {
+    std::unique_lock<std::mutex> lock( lock_);
+    not_full_.wait(lock, [this] { return items_.size() < capacity_; });
+    items_.push_back( item);
+    not_empty_.notify_one();
+  }
+  bool pop(T& item) {
+    std::unique_lock<std::mutex> lock( lock_);
+    not_empty_.wait(lock, [this] { return closed_ || !items_.empty(); });
+    if (items_.empty()) return false; // closed and drained
+    item = items_.front();
+    items_.pop_front();
+    not_full_.notify_one();
+    return true;
+  }
+  void close() {
+    std::lock_guard<std::mutex> lock( lock_);
+    closed_ = true;
+    not_empty_.notify_all();
+  }
+  size_t size() const {
+    std::lock_guard<std::mutex> lock( lock_);
+    return items_.size();
+  }
+  size_t capacity() const { return capacity_; }
+
+private:
+  size_t capacity_;
+  bool closed_;
+  std::deque<T> items_;
+  mutable std::mutex lock_;
+  std::condition_variable not_full_;
+  std::condition_variable not_empty_;
+};
+
+// A block of input text ending at a line boundary, and the URL tokens the
+// parser found in it. Blocks are allocated once and recycled.
+struct InputBlock {
+  char* data;       // page aligned buffer of block_size bytes
+  const char* text; // start of the text in data (the line carried from the
+                    // previous block, then what was read at a page boundary)
+  size_t size;      // number of valid bytes from text
+  size_t seq;     // position of the block in the input
+  vector<std::string_view> tokens; // URL tokens (Network::tokenize()), views into data
+};
+
+// IngestPipeline class - reads an edge list (InputStream) in large blocks on a reader
+// thread, tokenizes the blocks on parser thread(s) and inserts the edges into
+// a Network on the calling thread. The stages are connected by bounded queues,
+// so a slow stage holds back the faster ones without unbounded buffering, and
+// block buffers go back to a free list once the builder is done with them.
+// Blocks are built in input order, so Node IDs are the same as with operator>>.
+// Progress (edges, bytes, throughput and queue occupancy) is reported every
+// PROGRESS_REPORT_INTERVAL seconds at log level 2.
+class IngestPipeline {
+
+public:
+  IngestPipeline(InputStream& input, unsigned int num_parsers=1,
+		 size_t block_size=DEFAULT_READ_BLOCK_SIZE,
+		 unsigned int queue_depth=DEFAULT_QUEUE_DEPTH); // ctor
+  ~IngestPipeline(); // dtor - releases the block buffers
+
+  // read, parse and insert all the edges into net, returns false on read errors
+  bool build(Network& net);
+  // as build(), each block being inserted by num_threads threads
+  // (Network::add_edges_parallel()) while the next ones are read
+  bool build_parallel(Network& net, unsigned int num_threads);
+  // read the whole input into text (reader stage only), returns false on read errors
+  bool read_all(string& text);
+
+private:
+  InputStream& input_; // network file text
+  unsigned int num_parsers_;
+  size_t block_size_;
+
+  vector<InputBlock> blocks_;       // all the block buffers
+  BoundedQueue<InputBlock*> free_;   // recycled buffers     -> reader
+  BoundedQueue<InputBlock*> read_;   // reader               -> parsers
+  BoundedQueue<InputBlock*> parsed_; // parsers              -> builder
+
+  std::atomic<bool> read_error_;
+  std::atomic<unsigned long long> bytes_read_;
+  std::atomic<unsigned int> active_parsers_; // parser threads still running
+  bool building_;                           // build() (vs. read_all()) in progress
+  unsigned long long edges_built_;
+  std::chrono::steady_clock::time_point start_, last_report_;
+
+  // Stages :
+  void reader_stage();
+  void parser_stage();
+
+  // Helpers :
+  // read up to len bytes (fewer only at end of input), returns -1 on errors
+  ssize_t read_fully(char* buf, size_t len);
+  // log progress (final report : totals)
+  void report(bool final);
+
+  IngestPipeline( const IngestPipeline&); // copy ctor -not allowed
+  IngestPipeline& operator=( const IngestPipeline&); // assignment operator -not allowed
+};
+
+// Network loading (the tool and libpagerank, see RankJob.h) :
+// edges of an edge list text in memory, built by num_threads threads
+// (Network::add_edges_parallel()). The text is only read during the call.
+void load_network(Network& net, const char* text, size_t length, unsigned int num_threads);
+// edges of the network file on fd (plain or compressed, see InputStream),
+// block by block through an IngestPipeline : with more than one thread each
+// block is built concurrently (build_parallel()).
+// Returns false on read errors, fd is left open.
+bool load_network(Network& net, int fd, unsigned int num_threads);
+// edges of the network file at path, false if it can't be read
+bool load_network(Network& net, const string& path, unsigned int num_threads);
+
+#endif
@@ -0,0 +1,257 @@
+/*
+ * Copyright (c) 2012 Chammika Mannakkara
+ *
+ *    RankFile.cpp - Implementation of the rank snapshot files and diffs
+ *
+ *    This is a part of simple tool calculate the PageRank
+ *
+ *    This source code is free software; you can redistribute it
+ *    and/or modify it in source code form under the terms of the GNU
+ *    General Public License as published by the Free Software
+ *    Foundation; either version 2 of the License, or (at your option)
+ *    any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "RankFile.h"
+#include "Log.h"
+#include "defaults.h"
+
+static const char SNAPSHOT_MAGIC[8] = { 'P', 'R', 'S', 'N', 'A', 'P', '0', '2' };
+
+// rank of a record
+typedef float snapshot_rank_type;
+
+// LEB128 varint at p (before end), false if truncated or too long
+static bool read_varint(const char*& p, const char* end, uint64_t& value) {
+  value = 0;
+  for (int shift = 0; ; shift += 7) {
+    if (p == end || shift > 63) {
+      return false;
+    }
+    unsigned char byte = *p++;
+    value |= (uint64_t) (byte & 0x7f) << shift;
+    if (!(byte & 0x80)) return true;
+  }
+}
+
+// LEB128 varint of value into buf, returns its length
+static size_t write_varint(uint64_t value, unsigned char buf[10]) {
+  size_t n = 0;
+  for (;; value >>= 7) {
+    buf[n++] = (value & 0x7f) | ((value >> 7)? 0x80 : 0);
+    if (!(value >> 7)) return n;
+  }
+}
+
+struct RankFile::Header {
+  char magic[8];
+  uint64_t num_nodes;
+  uint64_t records_size; // bytes of the records
+};
+
+RankFile::RankFile() : addr_(MAP_FAILED), length_(0), header_(0), pos_(0), end_(0),
+			       read_(0) { }
+
+RankFile::~RankFile() {
+  if (addr_ != MAP_FAILED) {
+    munmap(addr_, length_);
+  }
+}
+
+bool RankFile::map(const string& path) {
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    ERROR("Couldn't open the rank snapshot : " << path << " (" << strerror(errno) << ")" << endl);
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(Header)) {
+    close( fd);
+    ERROR("Not a rank snapshot : " << path << endl);
+    return false;
+  }
+  length_ = st.st_size;
+  addr_ = mmap(0, length_, PROT_READ, MAP_SHARED, fd, 0);
+  close( fd);
+  if (addr_ == MAP_FAILED) {
+    ERROR("Couldn't map the rank snapshot : " << path << " (" << strerror(errno) << ")" << endl);
+    return false;
+  }
+  madvise(addr_, length_, MADV_SEQUENTIAL);
+  const char* base = static_cast<const char*>(addr_);
+  header_ = reinterpret_cast<const Header*>(base);
+  pos_ = base + sizeof(Header);
+  end_ = base + length_;
+  read_ = 0;
+  url_.clear();
+  if (memcmp(header_->magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0 ||
+      header_->records_size != length_ - sizeof(Header)) {
+    ERROR("Not a rank snapshot : " << path << endl);
+    return false;
+  }
+  return true;
+}
+
+uint64_t RankFile::num_nodes() const { return header_->num_nodes; }
+
+bool RankFile::next(std::string_view& url, rank_type& rank) {
+  if (read_ == header_->num_nodes || end_ - pos_ < (ptrdiff_t) sizeof(snapshot_rank_type)) {
+    return false;
+  }
+  const char* p = pos_;
+  snapshot_rank_type stored;
+  memcpy(&stored, p, sizeof(stored));
+  p += sizeof(stored);
+  uint64_t prefix, length;
+  if (!read_varint(p, end_, prefix) || !read_varint(p, end_, length) ||
+      prefix > url_.size() || (uint64_t) (end_ - p) < length) {
+    return false;
+  }
+  url_.resize( prefix);
+  url_.append(p, length);
+  url = url_;
+  rank = stored;
+  pos_ = p + length;
+  ++read_;
+  return true;
+}
+
+bool RankFile::write(const string& path, const vector<rank_type>& ranks, const Network& net) {
+  // written aside and renamed into place : readers see whole snapshots only
+  char suffix[32];
+  snprintf(suffix, sizeof(suffix), ".%ld.tmp", (long) getpid());
+  string tmp_path = path + suffix;
+  std::FILE* out = std::fopen(tmp_path.c_str(), "wb");
+  if (!out) {
+    ERROR("Couldn't write the rank snapshot : " << tmp_path << " (" << strerror(errno) << ")" << endl);
+    return false;
+  }
+  vector<char> buffer( RANK_SNAPSHOT_BUFFER_SIZE);
+  setvbuf(out, buffer.data(), _IOFBF, buffer.size());
+
+  Header header;
+  memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+  header.num_nodes = ranks.size();
+  header.records_size = 0;
+  bool ok = fwrite(&header, sizeof(header), 1, out) == 1;
+  string previous; // URL of the previous record
+  for (node_id_type node = 0; ok && node < ranks.size(); ++node) {
+    std::string_view url = net.url( node);
+    size_t prefix = 0;
+    const size_t max_prefix = std::min(url.size(), previous.size());
+    while (prefix < max_prefix && url[prefix] == previous[prefix]) ++prefix;
+    unsigned char lengths[20];
+    size_t n = write_varint(prefix, lengths);
+    n += write_varint(url.size() - prefix, lengths + n);
+    snapshot_rank_type rank = ranks[node];
+    ok = fwrite(&rank, sizeof(rank), 1, out) == 1
+      && fwrite(lengths, 1, n, out) == n
+      && fwrite(url.data() + prefix, 1, url.size() - prefix, out) == url.size() - prefix;
+    header.records_size += sizeof(rank) + n + url.size() - prefix;
+    previous.assign(url.data(), url.size());
+  }
+  ok = ok && fseek(out, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, out) == 1;
+  ok = (std::fclose(out) == 0) && ok;
+  if (!ok || rename(tmp_path.c_str(), path.c_str()) != 0) {
+    ERROR("Couldn't write the rank snapshot : " << path << " (" << strerror(errno) << ")" << endl);
+    unlink(tmp_path.c_str());
+    return false;
+  }
+  PRINT(LOG_LVL_2, "Rank snapshot written to " << path << " : " << ranks.size() << " nodes, "
+	<< sizeof(header) + header.records_size << " bytes" << endl);
+  return true;
+}
+
+// Output lines are formatted into a buffer of RANK_SNAPSHOT_BUFFER_SIZE bytes,
+// written to the stream when full
+class LineBuffer {
+public:
+  explicit LineBuffer(ostream& os) : os_(os) { buffer_.reserve( RANK_SNAPSHOT_BUFFER_SIZE); }
+  ~LineBuffer() { flush(); }
+
+  void line(char op, rank_type rank, std::string_view url) {
+    char head[40];
+    int n = snprintf(head, sizeof(head), "%c\t%g\t", op, rank);
+    append(head, n, url);
+  }
+  void line(char op, rank_type rank, rank_type old_rank, std::string_view url) {
+    char head[64];
+    int n = snprintf(head, sizeof(head), "%c\t%g\t%g\t", op, rank, old_rank);
+    append(head, n, url);
+  }
+  void flush() {
+    os_.write(buffer_.data(), buffer_.size());
+    buffer_.clear();
+  }
+
+private:
+  ostream& os_;
+  string buffer_;
+
+  void append(const char* head, size_t n, std::string_view url) {
+    if (buffer_.size() + n + url.size() + 1 > buffer_.capacity()) {
+      flush();
+    }
+    buffer_.append(head, n);
+    buffer_.append(url.data(), url.size());
+    buffer_.push_back('\n');
+  }
+};
+
+// 1. previous snapshot in its order : a URL not in net was removed, else the
+//    node is marked seen and its rank compared
+// 2. nodes not seen, in ID order : added
+bool diff_ranks(RankFile& previous, const Network& net, const vector<rank_type>& ranks,
+		rank_type tolerance, ostream& os, RankDiff& diff) {
+  diff = RankDiff();
+  LineBuffer out( os);
+  vector<char> seen( ranks.size(), 0);
+  std::string_view url;
+  rank_type old_rank;
+  while (previous.next(url, old_rank)) {
+    node_id_type id;
+    if (!net.find_node_id(url, id) || id >= ranks.size()) {
+      out.line('-', old_rank, url);
+      ++diff.removed;
+      continue;
+    }
+    seen[id] = 1;
+    rank_type rank = (snapshot_rank_type) ranks[id]; // as it would be stored
+    if (fabs(rank - old_rank) > tolerance * fabs(old_rank)) {
+      out.line('~', ranks[id], old_rank, url);
+      ++diff.changed;
+    }
+    else {
+      ++diff.unchanged;
+    }
+  }
+  if (!previous.complete()) {
+    ERROR("Rank snapshot truncated after " << diff.removed + diff.changed + diff.unchanged
+	  << " of " << previous.num_nodes() << " nodes" << endl);
+    return false;
+  }
+  for (node_id_type id = 0; id < ranks.size(); ++id) {
+    if (!seen[id]) {
+      out.line('+', ranks[id], net.url( id));
+      ++diff.added;
+    }
+  }
+  return true;
+}
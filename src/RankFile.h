@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2012 Chammika Mannakkara
+ *
+ *    RankFile.h - Binary rank snapshot files of a run, and the rank changes
+ *                 between two runs
+ *
+ *    This is a part of simple tool calculate the PageRank
+ *
+ *    This source code is free software; you can redistribute it
+ *    and/or modify it in source code form under the terms of the GNU
+ *    General Public License as published by the Free Software
+ *    Foundation; either version 2 of the License, or (at your option)
+ *    any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+#ifndef PAGERANK_RANK_FILE
+#define PAGERANK_RANK_FILE
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include "types.h"
+#include "Network.h"
+
+// RankFile class - read-only view of a rank snapshot file (--rank-snapshot),
+// mmap()'ed and read front to back. After the header, the file holds one
+// record per node, in node ID order of the run which wrote it : the rank (as
+// a 4 byte float), then the URL front coded against the URL of the previous
+// record - the length of their common prefix and the length of the rest
+// (LEB128 varints), and the rest of the URL. Consecutive IDs were issued in
+// input order, so their URLs mostly share the scheme and host.
+class RankFile {
+
+public:
+  RankFile(); // ctor
+  ~RankFile(); // dtor
+
+  // map a snapshot file, false if it isn't one
+  bool map(const string& path);
+
+  uint64_t num_nodes() const;
+  // next record, false at the end of the file or on a truncated record
+  // (see complete()). url is valid until the next call.
+  bool next(std::string_view& url, rank_type& rank);
+  // every record of the header was read
+  bool complete() const { return read_ == num_nodes() && pos_ == end_; }
+
+  // write the ranks of net to path, through a large sequential buffer
+  // (RANK_SNAPSHOT_BUFFER_SIZE). The file is written aside and renamed in
+  // place, so a snapshot being read (e.g. the one diffed against) stays
+  // valid. Returns false on errors.
+  static bool write(const string& path, const vector<rank_type>& ranks, const Network& net);
+
+  struct Header; // of the snapshot file
+
+private:
+  void* addr_;
+  size_t length_;
+  const Header* header_;
+  const char* pos_; // next record
+  const char* end_;
+  uint64_t read_;   // records read
+  string url_;      // URL of the last record read
+
+  RankFile( const RankFile&); // copy ctor -not allowed
+  RankFile& operator=( const RankFile&); // assignment operator -not allowed
+};
+
+// RankDiff - counts of a rank diff (diff_ranks())
+struct RankDiff {
+  size_t changed, added, removed, unchanged;
+};
+
+// Rank changes since the previous snapshot (--diff-against), one line per node
+// to os, through a large sequential buffer :
+//   ~ <rank> <previous_rank> <url>  rank moved by more than tolerance x previous rank
+//   + <rank> <url>                  node added (URL not in the previous snapshot)
+//   - <previous_rank> <url>         node removed (URL not in net)
+// The fields are tab separated : the lines give the new ranks from the
+// previous ones without the snapshot file. Ranks are compared at the float
+// precision of the snapshot. Nodes are matched by URL through the URL maps
+// (or the URL dictionary) of net. Returns false, with the lines of the
+// records read so far, if previous is truncated.
+// Complexity : O(N + N') URL lookups
+bool diff_ranks(RankFile& previous, const Network& net, const vector<rank_type>& ranks,
+		rank_type tolerance, ostream& os, RankDiff& diff);
+
+#endif
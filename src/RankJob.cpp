@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2012 Chammika Mannakkara
+ *
+ *    RankJob.cpp - Implementation of the PageRank background jobs
+ *
+ *    This is a part of simple tool calculate the PageRank
+ *
+ *    This source code is free software; you can redistribute it
+ *    and/or modify it in source code form under the terms of the GNU
+ *    General Public License as published by the Free Software
+ *    Foundation; either version 2 of the License, or (at your option)
+ *    any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+#include "RankJob.h"
+
+static const vector<rank_type> no_ranks;
+
+// ctor
+RankJob::RankJob(std::shared_ptr<PageRank> net, const Callback& progress)
+  : net_(net), progress_(progress), cancel_(false), status_(RUNNING), step_(0), change_(0.0),
+    ranks_(&no_ranks), result_(promise_.get_future().share()) {
+  worker_ = std::thread(&RankJob::run, this);
+}
+
+// dtor
+RankJob::~RankJob() {
+  cancel();
+  worker_.join();
+}
+
+const vector<rank_type>& RankJob::ranks() const {
+  result_.wait();
+  return *ranks_;
+}
+
+// The progress callback of the network counts the steps, forwards them and
+// tells the solver to stop once the job is cancelled
+void RankJob::run() {
+  net_->set_progress([this](unsigned int step, rank_type change) {
+    step_ = step;
+    change_ = change;
+    if (progress_) {
+      progress_(step, change);
+    }
+    return !cancel_;
+  });
+  try {
+    ranks_ = &net_->calculate_PageRanks();
+    net_->set_progress( ProgressCallback());
+    status_ = cancel_? CANCELLED : DONE;
+    PRINT(LOG_LVL_2, "Rank job " << (cancel_? "cancelled" : "done") << " after " << step_ 
+	  << " step(s)" << endl);
+    promise_.set_value( status_);
+  }
+  catch (...) {
+    net_->set_progress( ProgressCallback());
+    status_ = DONE;
+    promise_.set_exception( std::current_exception());
+  }
+}
@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2012 Chammika Mannakkara
+ *
+ *    RankJob.h - Embedding API : PageRank calculations as background jobs
+ *
+ *    This is a part of simple tool calculate the PageRank
+ *
+ *    This source code is free software; you can redistribute it
+ *    and/or modify it in source code form under the terms of the GNU
+ *    General Public License as published by the Free Software
+ *    Foundation; either version 2 of the License, or (at your option)
+ *    any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+#ifndef PAGERANK_RANK_JOB_CLASS
+#define PAGERANK_RANK_JOB_CLASS
+
+#include <atomic>
+#include <future>
+#include <memory>
+#include <thread>
+
+#include "PageRank.h"
+#include "Pipeline.h"
+#include "Parallel.h"
+#include "Log.h"
+
+// Embedding API (libpagerank, make lib) : a program builds a PageRank network
+// from memory or from a file with load_network() (Pipeline.h), sets its
+// parameters, and submits calculate_PageRanks() as a RankJob. The settings of
+// Globals.cpp are process wide and are to be set before jobs are submitted :
+// Parallel::num_threads_ (default thread count of the networks built after
+// it, PageRank::set_threads() sets one network's), Log::level_ and Log::out_
+// (PRINT output, std::cout by default). Jobs of different networks may run
+// concurrently, each on the threads of its own network. Their PRINT output
+// then goes to the same Log::out_ : a stream of the program (not std::cout)
+// needs Log::level_ 0, as concurrent writes to it are not synchronized.
+
+// RankJob class - calculate_PageRanks() of a network on a thread of its own.
+// The job shares the ownership of the network, which must not be modified
+// while the job runs. Progress is reported after each solver step (see
+// PageRank::set_progress()) to a callback and to the step()/change()
+// counters, and cancel() stops the solver after its current step.
+class RankJob {
+
+public:
+  typedef enum { RUNNING, DONE, CANCELLED } eStatus;
+  // called on the job's thread after each solver step
+  typedef std::function<void(unsigned int step, rank_type change)> Callback;
+
+  // start the calculation
+  RankJob(std::shared_ptr<PageRank> net, const Callback& progress=Callback()); // ctor
+  ~RankJob(); // dtor - cancels the calculation and waits for the thread
+
+  // cooperative cancellation : the ranks are those of the last step
+  void cancel() { cancel_ = true; }
+
+  // status, and the last step reported and its change
+  eStatus status() const { return status_; }
+  unsigned int step() const { return step_; }
+  rank_type change() const { return change_; }
+
+  // final status : get() waits for the job, and rethrows the exception which
+  // ended the calculation if any (eg. std::bad_alloc)
+  std::shared_future<eStatus> result() const { return result_; }
+  eStatus wait() const { return result_.get(); }
+
+  // PageRanks by node ID, without a copy : waits for the job, then refers to
+  // the ranks of the network (empty if the calculation failed)
+  const vector<rank_type>& ranks() const;
+  const PageRank& network() const { return *net_; }
+
+private:
+  std::shared_ptr<PageRank> net_;
+  Callback progress_;
+  std::atomic<bool> cancel_;
+  std::atomic<eStatus> status_;
+  std::atomic<unsigned int> step_;
+  std::atomic<rank_type> change_;
+  const vector<rank_type>* ranks_; // set by the job before the result
+  std::promise<eStatus> promise_;
+  std::shared_future<eStatus> result_;
+  std::thread worker_;
+
+  // the job's thread
+  void run();
+
+  RankJob( const RankJob&); // copy ctor -not allowed
+  RankJob& operator=( const RankJob&); // assignment operator -not allowed
+};
+
+#endif
@@ -0,0 +1,348 @@
+/*
+ * Copyright (c) 2012 Chammika Mannakkara
+ *
+ *    ResultCache.cpp - Implementation of the on-disk result cache
+ *
+ *    This is a part of simple tool calculate the PageRank
+ *
+ *    This source code is free software; you can redistribute it
+ *    and/or modify it in source code form under the terms of the GNU
+ *    General Public License as published by the Free Software
+ *    Foundation; either version 2 of the License, or (at your option)
+ *    any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "ResultCache.h"
+#include "Log.h"
+#include "defaults.h"
+
+// -- StreamHash : XXH64 --
+
+static const uint64_t PRIME1 = 11400714785074694791ULL;
+static const uint64_t PRIME2 = 14029467366897019727ULL;
+static const uint64_t PRIME3 =  1609587929392839161ULL;
+static const uint64_t PRIME4 =  9650029242287828579ULL;
+static const uint64_t PRIME5 =  2870177450012600261ULL;
+
+static inline uint64_t rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+static inline uint64_t read64(const unsigned char* p) { uint64_t v; memcpy(&v, p, 8); return v; }
+static inline uint32_t read32(const unsigned char* p) { uint32_t v; memcpy(&v, p, 4); return v; }
+
+static inline uint64_t round64(uint64_t acc, uint64_t input) {
+  acc += input * PRIME2;
+  return rotl(acc, 31) * PRIME1;
+}
+
+static inline uint64_t merge64(uint64_t acc, uint64_t val) {
+  acc ^= round64(0, val);
+  return acc * PRIME1 + PRIME4;
+}
+
+StreamHash::StreamHash(uint64_t seed) : buffered_(0), total_(0), seed_(seed) {
+  acc_[0] = seed + PRIME1 + PRIME2;
+  acc_[1] = seed + PRIME2;
+  acc_[2] = seed;
+  acc_[3] = seed - PRIME1;
+}
+
+void StreamHash::update(const void* data, size_t size) {
+  const unsigned char* p = static_cast<const unsigned char*>(data);
+  const unsigned char* end = p + size;
+  total_ += size;
+  if (buffered_) { // complete the partial stripe first
+    size_t take = std::min(size, sizeof(buf_) - buffered_);
+    memcpy(buf_ + buffered_, p, take);
+    buffered_ += take;
+    p += take;
+    if (buffered_ < sizeof(buf_)) return;
+    for (int lane = 0; lane < 4; ++lane) {
+      acc_[lane] = round64(acc_[lane], read64(buf_ + 8 * lane));
+    }
+    buffered_ = 0;
+  }
+  uint64_t a0 = acc_[0], a1 = acc_[1], a2 = acc_[2], a3 = acc_[3];
+  for (; end - p >= 32; p += 32) {
+    a0 = round64(a0, read64(p));
+    a1 = round64(a1, read64(p + 8));
+    a2 = round64(a2, read64(p + 16));
+    a3 = round64(a3, read64(p + 24));
+  }
+  acc_[0] = a0; acc_[1] = a1; acc_[2] = a2; acc_[3] = a3;
+  memcpy(buf_, p, end - p);
+  buffered_ = end - p;
+}
+
+uint64_t StreamHash::digest() const {
+  uint64_t h;
+  if (total_ >= 32) {
+    h = rotl(acc_[0], 1) + rotl(acc_[1], 7) + rotl(acc_[2], 12) + rotl(acc_[3], 18);
+    for (int lane = 0; lane < 4; ++lane) {
+      h = merge64(h, acc_[lane]);
+    }
+  }
+  else {
+    h = seed_ + PRIME5;
+  }
+  h += total_;
+  const unsigned char* p = buf_;
+  const unsigned char* end = buf_ + buffered_;
+  for (; end - p >= 8; p += 8) {
+    h ^= round64(0, read64(p));
+    h = rotl(h, 27) * PRIME1 + PRIME4;
+  }
+  if (end - p >= 4) {
+    h ^= (uint64_t) read32(p) * PRIME1;
+    h = rotl(h, 23) * PRIME2 + PRIME3;
+    p += 4;
+  }
+  for (; p < end; ++p) {
+    h ^= *p * PRIME5;
+    h = rotl(h, 11) * PRIME1;
+  }
+  h ^= h >> 33;
+  h *= PRIME2;
+  h ^= h >> 29;
+  h *= PRIME3;
+  h ^= h >> 32;
+  return h;
+}
+
+// -- CacheEntry --
+
+// Layout of a cache file (native byte order, every part 8-byte aligned) :
+// Header, params, values[num_values], group_end[num_groups],
+// string_end[num_strings], chars[chars_size]
+static const char CACHE_MAGIC[8] = { 'P', 'R', 'C', 'A', 'C', 'H', 'E', '1' };
+
+struct CacheEntry::Header {
+  char magic[8];
+  uint64_t input_size;
+  uint64_t params_size;
+  uint64_t num_values;
+  uint64_t num_groups;
+  uint64_t num_strings;
+  uint64_t chars_size;
+};
+
+static inline uint64_t align8(uint64_t n) { return (n + 7) & ~(uint64_t) 7; }
+
+CacheEntry::CacheEntry() : addr_(MAP_FAILED), length_(0), header_(0), values_(0),
+			   group_end_(0), string_end_(0), chars_(0) { }
+
+CacheEntry::~CacheEntry() {
+  if (addr_ != MAP_FAILED) {
+    munmap(addr_, length_);
+  }
+}
+
+bool CacheEntry::map(const string& path, uint64_t input_size, const string& params) {
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(Header)) {
+    close( fd);
+    return false;
+  }
+  length_ = st.st_size;
+  addr_ = mmap(0, length_, PROT_READ, MAP_SHARED, fd, 0);
+  close( fd);
+  if (addr_ == MAP_FAILED) {
+    return false;
+  }
+  const char* base = static_cast<const char*>(addr_);
+  header_ = reinterpret_cast<const Header*>(base);
+  uint64_t offset = sizeof(Header);
+  const char* stored_params = base + offset;
+  offset += align8(header_->params_size);
+  values_ = reinterpret_cast<const rank_type*>(base + offset);
+  offset += header_->num_values * sizeof(rank_type);
+  group_end_ = reinterpret_cast<const uint64_t*>(base + offset);
+  offset += header_->num_groups * sizeof(uint64_t);
+  string_end_ = reinterpret_cast<const uint64_t*>(base + offset);
+  offset += header_->num_strings * sizeof(uint64_t);
+  chars_ = base + offset;
+  offset += header_->chars_size;
+  // the key is a hash : the input size and the parameters are checked as well
+  return memcmp(header_->magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) == 0
+    && offset == length_ && header_->input_size == input_size
+    && header_->params_size == params.size()
+    && memcmp(stored_params, params.data(), params.size()) == 0;
+}
+
+size_t CacheEntry::num_values() const { return header_->num_values; }
+const rank_type* CacheEntry::values() const { return values_; }
+size_t CacheEntry::num_strings() const { return header_->num_strings; }
+size_t CacheEntry::num_groups() const { return header_->num_groups; }
+
+pair<const char*, size_t> CacheEntry::str(size_t i) const {
+  uint64_t begin = i? string_end_[i - 1] : 0;
+  return pair<const char*, size_t>(chars_ + begin, string_end_[i] - begin);
+}
+
+size_t CacheEntry::group_begin(size_t g) const {
+  return g? group_end_[g - 1] : 0;
+}
+
+// -- ResultCache --
+
+ResultCache::ResultCache(const string& dir, uint64_t size_cap) : dir_(dir), size_cap_(size_cap),
+								   input_size_(0) { }
+
+bool ResultCache::open(int net_fd, const string& params) {
+  if (mkdir(dir_.c_str(), 0777) != 0 && errno != EEXIST) {
+    ERROR("Couldn't create the cache directory : " << dir_ << " (" << strerror(errno) << ")" << endl);
+    return false;
+  }
+  StreamHash hash;
+  vector<char> buf(DEFAULT_READ_BLOCK_SIZE);
+  off_t offset = 0;
+  for (;;) {
+    ssize_t n = pread(net_fd, &buf[0], buf.size(), offset);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      PRINT(LOG_LVL_2, "Result cache off : the network file can't be hashed ("
+	    << strerror(errno) << ")" << endl);
+      return false;
+    }
+    if (n == 0) break;
+    hash.update(&buf[0], n);
+    offset += n;
+  }
+  hash.update(params.data(), params.size());
+  params_ = params;
+  input_size_ = offset;
+  char name[32];
+  snprintf(name, sizeof(name), "/%016llx.prc", (unsigned long long) hash.digest());
+  path_ = dir_ + name;
+  return true;
+}
+
+bool ResultCache::lookup(CacheEntry& entry) {
+  if (!entry.map(path_, input_size_, params_)) {
+    return false;
+  }
+  utimensat(AT_FDCWD, path_.c_str(), 0, 0); // most recently used
+  return true;
+}
+
+bool ResultCache::store_ranks(const vector<rank_type>& ranks, const Network& net) {
+  vector<uint64_t> string_end;
+  string chars;
+  string_end.reserve( ranks.size());
+  for (node_id_type node = 0; node < ranks.size(); ++node) {
+    chars += net.url( node);
+    string_end.push_back( chars.size());
+  }
+  return store(ranks, vector<uint64_t>(), string_end, chars);
+}
+
+bool ResultCache::store_checks(const vector<Node>& leaks, const vector<vector<Node> >& sinks) {
+  vector<uint64_t> group_end, string_end;
+  std::ostringstream chars;
+  for (const Node& node : leaks) {
+    chars << node;
+    string_end.push_back( chars.tellp());
+  }
+  group_end.push_back( string_end.size());
+  for (const vector<Node>& group : sinks) {
+    for (const Node& node : group) {
+      chars << node;
+      string_end.push_back( chars.tellp());
+    }
+    group_end.push_back( string_end.size());
+  }
+  return store(vector<rank_type>(), group_end, string_end, chars.str());
+}
+
+bool ResultCache::store(const vector<rank_type>& values, const vector<uint64_t>& group_end,
+			const vector<uint64_t>& string_end, const string& chars) {
+  CacheEntry::Header header;
+  memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+  header.input_size = input_size_;
+  header.params_size = params_.size();
+  header.num_values = values.size();
+  header.num_groups = group_end.size();
+  header.num_strings = string_end.size();
+  header.chars_size = chars.size();
+
+  // written aside and renamed into place : readers see whole entries only
+  char suffix[32];
+  snprintf(suffix, sizeof(suffix), ".%ld.tmp", (long) getpid());
+  string tmp_path = path_ + suffix;
+  std::FILE* out = std::fopen(tmp_path.c_str(), "wb");
+  if (!out) {
+    PRINT(LOG_LVL_2, "Result cache : couldn't write " << tmp_path << " (" << strerror(errno) << ")" << endl);
+    return false;
+  }
+  static const char padding[8] = { 0 };
+  bool ok = fwrite(&header, sizeof(header), 1, out) == 1
+    && fwrite(params_.data(), 1, params_.size(), out) == params_.size()
+    && fwrite(padding, 1, align8(params_.size()) - params_.size(), out) == align8(params_.size()) - params_.size()
+    && fwrite(values.data(), sizeof(rank_type), values.size(), out) == values.size()
+    && fwrite(group_end.data(), sizeof(uint64_t), group_end.size(), out) == group_end.size()
+    && fwrite(string_end.data(), sizeof(uint64_t), string_end.size(), out) == string_end.size()
+    && fwrite(chars.data(), 1, chars.size(), out) == chars.size();
+  ok = (std::fclose(out) == 0) && ok;
+  if (!ok || rename(tmp_path.c_str(), path_.c_str()) != 0) {
+    PRINT(LOG_LVL_2, "Result cache : couldn't write " << path_ << endl);
+    unlink(tmp_path.c_str());
+    return false;
+  }
+  evict();
+  return true;
+}
+
+// remove the least recently used entries while the entries take more than
+// the size cap (the entry just stored is kept)
+void ResultCache::evict() {
+  DIR* dir = opendir(dir_.c_str());
+  if (!dir) {
+    return;
+  }
+  vector<pair<struct timespec, pair<string, uint64_t> > > entries;
+  uint64_t total = 0;
+  while (struct dirent* e = readdir(dir)) {
+    size_t len = strlen(e->d_name);
+    if (len < 4 || strcmp(e->d_name + len - 4, ".prc") != 0) continue;
+    string path = dir_ + '/' + e->d_name;
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) continue;
+    total += st.st_size;
+    if (path != path_) {
+      entries.push_back( std::make_pair(st.st_mtim, std::make_pair(path, (uint64_t) st.st_size)));
+    }
+  }
+  closedir( dir);
+  sort(entries.begin(), entries.end(), [](const decltype(entries)::value_type& a,
+					  const decltype(entries)::value_type& b) {
+	 return a.first.tv_sec < b.first.tv_sec
+	   || (a.first.tv_sec == b.first.tv_sec && a.first.tv_nsec < b.first.tv_nsec);
+       });
+  for (size_t i = 0; i < entries.size() && total > size_cap_; ++i) {
+    if (unlink(entries[i].second.first.c_str()) == 0) {
+      PRINT(LOG_LVL_2, "Result cache : evicted " << entries[i].second.first << endl);
+      total -= entries[i].second.second;
+    }
+  }
+}
@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2012 Chammika Mannakkara
+ *
+ *    ResultCache.h - On-disk cache of run/check mode results, keyed by a
+ *                    hash of the network file and the solver parameters
+ *
+ *    This is a part of simple tool calculate the PageRank
+ *
+ *    This source code is free software; you can redistribute it
+ *    and/or modify it in source code form under the terms of the GNU
+ *    General Public License as published by the Free Software
+ *    Foundation; either version 2 of the License, or (at your option)
+ *    any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+#ifndef PAGERANK_RESULT_CACHE
+#define PAGERANK_RESULT_CACHE
+
+#include <cstddef>
+#include <cstdint>
+
+#include "types.h"
+#include "Network.h"
+
+// StreamHash class - 64-bit streaming hash (the XXH64 function) of a byte
+// stream given in pieces of any size
+class StreamHash {
+
+public:
+  StreamHash(uint64_t seed=0); // ctor
+
+  void update(const void* data, size_t size);
+  uint64_t digest() const;
+
+private:
+  uint64_t acc_[4];   // lanes of the 32-byte stripes
+  unsigned char buf_[32]; // partial stripe
+  size_t buffered_;
+  uint64_t total_;
+  uint64_t seed_;
+};
+
+// CacheEntry class - read-only view of a cached result, mmap()'ed from the
+// cache file. A run mode entry holds one rank and one URL per node ID, a check
+// mode entry the leak nodes (group 0) and the sink groups (groups 1..) as
+// written by exec_check_mode.
+class CacheEntry {
+
+public:
+  CacheEntry(); // ctor
+  ~CacheEntry(); // dtor
+
+  // map the cache file, false if it isn't a valid entry for the parameters
+  bool map(const string& path, uint64_t input_size, const string& params);
+
+  size_t num_values() const;
+  const rank_type* values() const;
+  size_t num_strings() const;
+  pair<const char*, size_t> str(size_t i) const;
+  // strings of group g are [group_begin(g), group_begin(g+1))
+  size_t num_groups() const;
+  size_t group_begin(size_t g) const;
+
+  struct Header; // of the cache file
+
+private:
+
+  void* addr_;
+  size_t length_;
+  const Header* header_;
+  const rank_type* values_;
+  const uint64_t* group_end_;
+  const uint64_t* string_end_;
+  const char* chars_;
+
+  CacheEntry( const CacheEntry&); // copy ctor -not allowed
+  CacheEntry& operator=( const CacheEntry&); // assignment operator -not allowed
+};
+
+// ResultCache class - directory of cache entries (--cache <dir>). The key of
+// an entry is the hash of the network file bytes (as stored, compressed or
+// not) and of the parameters string which names the mode and every parameter
+// the result depends on. Entries are written to a temporary file and renamed,
+// so concurrent jobs on the same key never see a partial entry. Entries used
+// least recently (by modification time, refreshed on every hit) are removed
+// while the directory holds more than the size cap.
+class ResultCache {
+
+public:
+  ResultCache(const string& dir, uint64_t size_cap); // ctor
+
+  // hash the network file (read with pread(), the file offset is left as is)
+  // and the parameters. false if the file can't be hashed, e.g. a pipe
+  bool open(int net_fd, const string& params);
+
+  // map the entry of the key, false on a miss
+  bool lookup(CacheEntry& entry);
+
+  // store a run mode result : ranks and URLs by node ID
+  bool store_ranks(const vector<rank_type>& ranks, const Network& net);
+  // store a check mode result : leak nodes and sink groups
+  bool store_checks(const vector<Node>& leaks, const vector<vector<Node> >& sinks);
+
+  const string& path() const { return path_; }
+
+private:
+  string dir_;
+  uint64_t size_cap_;
+  string params_;
+  uint64_t input_size_;
+  string path_; // entry of the key
+
+  bool store(const vector<rank_type>& values, const vector<uint64_t>& group_end,
+	     const vector<uint64_t>& string_end, const string& chars);
+  void evict();
+};
+
+#endif
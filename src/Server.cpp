@@ -0,0 +1,331 @@
+/*
+ * Copyright (c) 2012 Chammika Mannakkara
+ *
+ *    Server.cpp - Implementation of the resident PageRank server
+ *
+ *    This is a part of simple tool calculate the PageRank
+ *
+ *    This source code is free software; you can redistribute it
+ *    and/or modify it in source code form under the terms of the GNU
+ *    General Public License as published by the Free Software
+ *    Foundation; either version 2 of the License, or (at your option)
+ *    any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "Server.h"
+#include "Log.h"
+
+// Build the graph part of a snapshot from a network.
+static std::shared_ptr<RankSnapshot> make_snapshot(const Network& n) {
+  std::shared_ptr<RankSnapshot> snap = std::make_shared<RankSnapshot>();
+  snap->urls.reserve( n.num_nodes());
+  for (node_id_type i = 0; i < n.num_nodes(); ++i) {
+    snap->urls.push_back( string( n.url( i)));
+  }
+  snap->ids.reserve( snap->urls.size());
+  for (node_id_type i = 0; i < snap->urls.size(); ++i) {
+    snap->ids.emplace( std::string_view(snap->urls[i]), i);
+  }
+  snap->link_offsets.reserve( snap->urls.size() + 1);
+  snap->link_offsets.push_back( 0);
+  snap->links.reserve( n.num_edges());
+  for (node_id_type i = 0; i < snap->urls.size(); ++i) {
+    const neighbor_set_type& neighbors = n.neighbors( i);
+    for (attr_citer iter = neighbors.begin(); iter != neighbors.end(); ++iter) {
+      snap->links.push_back( iter->first);
+    }
+    snap->link_offsets.push_back( snap->links.size());
+  }
+  return snap;
+}
+
+// order IDs by decreasing rank (ties by ID to keep TOP answers stable)
+struct CompRank {
+  CompRank(const vector<rank_type>& ranks) : ranks_(ranks) { }
+  bool operator()(node_id_type a, node_id_type b) const {
+    return (ranks_[a] != ranks_[b])? ranks_[a] > ranks_[b] : a < b;
+  }
+  const vector<rank_type>& ranks_;
+};
+
+// ctor
+RankServer::RankServer(const PageRank& parameters)
+  : parameters_(0.0, 0, NO_CONVERGENCE_CHECK), pending_batches_(0), stopping_(false),
+    listen_fd_(-1), stopped_(false) {
+  parameters_.copy_parameters( parameters);
+  worker_ = std::thread(&RankServer::recompute_loop, this);
+}
+
+// dtor
+RankServer::~RankServer() {
+  join_clients( true);
+  {
+    std::lock_guard<std::mutex> lock( pending_lock_);
+    stopping_ = true;
+  }
+  pending_cv_.notify_all();
+  worker_.join();
+}
+
+// Compute the PageRanks of the network n and publish them as the current snapshot
+void RankServer::publish(PageRank& n) {
+  std::shared_ptr<RankSnapshot> snap = make_snapshot( n);
+  snap->ranks = n.calculate_PageRanks();
+  snap->by_rank.resize( snap->ranks.size());
+  for (node_id_type i = 0; i < snap->by_rank.size(); ++i) {
+    snap->by_rank[i] = i;
+  }
+  sort(snap->by_rank.begin(), snap->by_rank.end(), CompRank( snap->ranks));
+
+  std::shared_ptr<const RankSnapshot> current = snapshot();
+  snap->version = current? current->version + 1 : 1;
+  std::atomic_store( &snapshot_, std::shared_ptr<const RankSnapshot>(snap));
+  PRINT(LOG_LVL_2, "Published snapshot #" << snap->version << " : " << snap->urls.size()
+	<< " nodes, " << snap->links.size() << " edges" << endl);
+}
+
+// Accept loop : one thread per client connection
+bool RankServer::run(const string& socket_path) {
+  sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (socket_path.size() >= sizeof(addr.sun_path)) {
+    ERROR("Socket path is too long : " << socket_path << endl);
+    return false;
+  }
+  strncpy(addr.sun_path, socket_path.c_str(), sizeof(addr.sun_path) - 1);
+
+  int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listen_fd < 0) {
+    ERROR("Couldn't create socket : " << strerror(errno) << endl);
+    return false;
+  }
+  unlink( socket_path.c_str()); // stale socket of a previous run
+  if (bind(listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 ||
+      listen(listen_fd, SOMAXCONN) < 0) {
+    ERROR("Couldn't listen on " << socket_path << " : " << strerror(errno) << endl);
+    close( listen_fd);
+    return false;
+  }
+  PRINT(LOG_LVL_1, "Serving PageRanks on " << socket_path << endl);
+  listen_fd_ = listen_fd;
+  if (stopped_) { // stop() before the socket was published
+    shutdown(listen_fd, SHUT_RDWR);
+  }
+
+  while (true) {
+    int fd = accept(listen_fd, 0, 0);
+    if (fd < 0) {
+      if (errno == EINTR && !stopped_) continue;
+      if (!stopped_) {
+	ERROR("accept() failed : " << strerror(errno) << endl);
+      }
+      break;
+    }
+    std::lock_guard<std::mutex> lock( clients_lock_);
+    join_clients( false);
+    clients_.push_back( Client());
+    Client& client = clients_.back();
+    client.fd = fd;
+    client.done = false;
+    client.thread = std::thread(&RankServer::serve_client, this, &client);
+  }
+  listen_fd_ = -1;
+  close( listen_fd);
+  join_clients( true);
+  return stopped_;
+}
+
+void RankServer::stop() {
+  stopped_ = true;
+  int listen_fd = listen_fd_;
+  if (listen_fd >= 0) {
+    shutdown(listen_fd, SHUT_RDWR); // wakes accept() up
+  }
+}
+
+// With all, the sockets are shut down first : the reads of the threads return
+// and they finish. Called with clients_lock_ held unless all.
+void RankServer::join_clients(bool all) {
+  std::list<Client> finished;
+  if (all) {
+    std::lock_guard<std::mutex> lock( clients_lock_);
+    for (Client& client : clients_) {
+      shutdown(client.fd, SHUT_RDWR);
+    }
+    finished.swap( clients_);
+  }
+  else {
+    for (std::list<Client>::iterator iter = clients_.begin(); iter != clients_.end(); ) {
+      std::list<Client>::iterator next = std::next( iter);
+      if (iter->done) finished.splice(finished.end(), clients_, iter);
+      iter = next;
+    }
+  }
+  for (Client& client : finished) { // the threads don't take clients_lock_ once done
+    client.thread.join();
+    close( client.fd);
+  }
+}
+
+// Read request lines from a client and write back the replies
+void RankServer::serve_client(Client* client) {
+  const int fd = client->fd;
+  vector<EdgeDelta> batch; // uncommitted deltas of this connection
+  string buffered, reply;
+  char buf[4096];
+  bool open = true;
+  while (open) {
+    ssize_t len = read(fd, buf, sizeof(buf));
+    if (len <= 0) break;
+    buffered.append(buf, len);
+    size_t eol;
+    while (open && (eol = buffered.find('\n')) != string::npos) {
+      string line = buffered.substr(0, eol);
+      buffered.erase(0, eol + 1);
+      if (!line.empty() && line[line.size()-1] == '\r') line.erase(line.size()-1);
+      reply.clear();
+      open = handle_request(line, batch, reply);
+      reply += "END\n";
+      for (size_t sent = 0; sent < reply.size(); ) {
+	ssize_t n = send(fd, reply.data() + sent, reply.size() - sent, MSG_NOSIGNAL);
+	if (n <= 0) { open = false; break; }
+	sent += n;
+      }
+    }
+  }
+  std::lock_guard<std::mutex> lock( clients_lock_);
+  client->done = true;
+}
+
+// Answer a single request. Queries are served from the snapshot current at the
+// time of the request.
+bool RankServer::handle_request(const string& line, vector<EdgeDelta>& batch, string& reply) {
+  std::istringstream request( line);
+  std::ostringstream out;
+  string cmd, arg1, arg2;
+  request >> cmd >> arg1 >> arg2;
+  std::shared_ptr<const RankSnapshot> snap = snapshot();
+
+  if (cmd == "RANK" || cmd == "NEIGHBORS") {
+    auto iter = snap->ids.find( std::string_view(arg1));
+    if (iter == snap->ids.end()) {
+      out << "ERR unknown url " << arg1 << endl;
+    }
+    else if (cmd == "RANK") {
+      out << snap->ranks[iter->second] << '\t' << arg1 << endl;
+    }
+    else {
+      for (size_t l = snap->link_offsets[iter->second]; l < snap->link_offsets[iter->second + 1]; ++l) {
+	node_id_type id = snap->links[l];
+	out << snap->ranks[id] << '\t' << snap->urls[id] << endl;
+      }
+    }
+  }
+  else if (cmd == "TOP") {
+    size_t k = std::min<size_t>(strtoul(arg1.c_str(), 0, 10), snap->by_rank.size());
+    for (size_t i = 0; i < k; ++i) {
+      node_id_type id = snap->by_rank[i];
+      out << snap->ranks[id] << '\t' << snap->urls[id] << endl;
+    }
+  }
+  else if ((cmd == "ADD" || cmd == "DEL") && !arg2.empty()) {
+    EdgeDelta delta = { cmd == "ADD", arg1, arg2 };
+    batch.push_back( delta);
+  }
+  else if (cmd == "COMMIT") {
+    out << "QUEUED " << batch.size() << " delta(s)" << endl;
+    submit( batch);
+  }
+  else if (cmd == "STATUS") {
+    std::lock_guard<std::mutex> lock( pending_lock_);
+    out << "version " << snap->version << endl
+	<< "nodes " << snap->urls.size() << endl
+	<< "edges " << snap->links.size() << endl
+	<< "pending " << pending_batches_ << endl;
+  }
+  else if (cmd == "QUIT") {
+    return false;
+  }
+  else {
+    out << "ERR bad request" << endl;
+  }
+  reply = out.str();
+  return true;
+}
+
+// Queue a delta batch for the background worker
+void RankServer::submit(vector<EdgeDelta>& batch) {
+  if (batch.empty()) return;
+  {
+    std::lock_guard<std::mutex> lock( pending_lock_);
+    pending_.insert(pending_.end(), batch.begin(), batch.end());
+    ++pending_batches_;
+  }
+  batch.clear();
+  pending_cv_.notify_one();
+}
+
+// Background worker. All batches queued while a recomputation runs are applied
+// together by the next one.
+void RankServer::recompute_loop() {
+  while (true) {
+    vector<EdgeDelta> deltas;
+    {
+      std::unique_lock<std::mutex> lock( pending_lock_);
+      pending_cv_.wait(lock, [this] { return stopping_ || !pending_.empty(); });
+      if (stopping_) return;
+      deltas.swap( pending_);
+      pending_batches_ = 0;
+    }
+    PRINT(LOG_LVL_2, "Applying " << deltas.size() << " edge delta(s)..." << endl);
+    PageRank n(0.0, 0, NO_CONVERGENCE_CHECK); // parameters copied below
+    n.copy_parameters( parameters_);
+    std::shared_ptr<const RankSnapshot> base = snapshot();
+    rebuild(*base, deltas, n);
+    n.set_warm_start( base->ranks); // the nodes of base keep their IDs
+    publish( n);
+  }
+}
+
+// Build a network holding the snapshot graph with the deltas applied.
+// Nodes are added first in ID order, so existing nodes keep their IDs.
+void RankServer::rebuild(const RankSnapshot& base, const vector<EdgeDelta>& deltas, PageRank& n) const {
+  map<pair<string, string>, bool> final_state; // last delta of an edge wins
+  for (size_t i = 0; i < deltas.size(); ++i) {
+    final_state[pair<string, string>(deltas[i].src_url, deltas[i].dst_url)] = deltas[i].add;
+  }
+
+  for (node_id_type i = 0; i < base.urls.size(); ++i) {
+    n.add_node( base.urls[i]);
+  }
+  for (node_id_type i = 0; i < base.urls.size(); ++i) {
+    for (size_t l = base.link_offsets[i]; l < base.link_offsets[i+1]; ++l) {
+      const string& dst = base.urls[base.links[l]];
+      if (!final_state.count( pair<string, string>(base.urls[i], dst))) { // not touched by deltas
+	n.add_edge(base.urls[i], dst);
+      }
+    }
+  }
+  for (map<pair<string, string>, bool>::const_iterator iter = final_state.begin(); 
+       iter != final_state.end(); ++iter) {
+    if (iter->second) { // added (or kept) edge
+      n.add_edge(iter->first.first, iter->first.second);
+    }
+  }
+}
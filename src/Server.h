@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) 2012 Chammika Mannakkara
+ *
+ *    Server.h - Resident PageRank server answering rank queries on a
+ *               Unix domain socket
+ *
+ *    This is a part of simple tool calculate the PageRank
+ *
+ *    This source code is free software; you can redistribute it
+ *    and/or modify it in source code form under the terms of the GNU
+ *    General Public License as published by the Free Software
+ *    Foundation; either version 2 of the License, or (at your option)
+ *    any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+#ifndef PAGERANK_SERVER_CLASS
+#define PAGERANK_SERVER_CLASS
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <string_view>
+#include <unordered_map>
+
+#include "PageRank.h"
+
+// RankSnapshot - immutable, self contained copy of a network and its PageRanks.
+// Queries are answered from a snapshot only, so a new snapshot can be computed
+// while the current one is being read.
+struct RankSnapshot {
+  unsigned long version;
+  vector<string> urls;                  // ID -> URL
+  std::unordered_map<std::string_view, node_id_type> ids; // URL -> ID (keys point into urls)
+  vector<size_t> link_offsets;          // outbound links of ID i are
+  vector<node_id_type> links;           //   links[link_offsets[i] .. link_offsets[i+1])
+  vector<rank_type> ranks;              // ID -> PageRank
+  vector<node_id_type> by_rank;         // IDs in decreasing PageRank order
+};
+
+// An edge change submitted to the server : ADD or DEL src -> dst
+struct EdgeDelta {
+  bool add;
+  string src_url;
+  string dst_url;
+};
+
+// RankServer class - keeps the PageRanks of a network resident and serves
+// rank-by-URL, top-k and neighbor queries over a Unix domain socket.
+// Edge delta batches are applied by a background thread which rebuilds the
+// network, recomputes the PageRanks (with the calculation parameters the
+// server was given, starting from the ranks of the current snapshot) and
+// publishes a new RankSnapshot atomically; readers always see a complete
+// snapshot and never wait for it.
+//
+// Protocol (one request per line, every response is terminated by "END") :
+//   RANK <url>              -> <rank> <tab> <url>
+//   TOP <k>                 -> k lines of <rank> <tab> <url>
+//   NEIGHBORS <url>         -> <rank> <tab> <url> for each outbound link
+//   ADD <src_url> <dst_url> -> queue an edge insertion in this connection's batch
+//   DEL <src_url> <dst_url> -> queue an edge removal in this connection's batch
+//   COMMIT                  -> submit the batch for background recomputation
+//   STATUS                  -> snapshot version, nodes, edges, pending batches
+//   QUIT                    -> close the connection
+class RankServer {
+
+public:
+  // recomputations use the calculation parameters of parameters (see
+  // PageRank::copy_parameters())
+  explicit RankServer(const PageRank& parameters); // ctor
+  ~RankServer(); // dtor - closes the connections, stops the background worker
+
+  // compute the PageRanks of a network and publish them as current snapshot
+  void publish(PageRank& n);
+
+  // accept and serve connections on socket_path until stop(), returns false
+  // on socket errors. The connections are closed and their threads joined
+  // before it returns.
+  bool run(const string& socket_path);
+  // make run() return (from any thread)
+  void stop();
+
+  // current snapshot (never blocks on a recomputation)
+  std::shared_ptr<const RankSnapshot> snapshot() const { return std::atomic_load( &snapshot_); }
+
+private:
+  // A client connection and the thread serving it
+  struct Client {
+    std::thread thread;
+    int fd;    // closed once the thread is joined
+    bool done; // the thread is finishing (guarded by clients_lock_)
+  };
+
+  // PageRank calculation parameters used for each recomputation (no network)
+  PageRank parameters_;
+
+  // published snapshot : only accessed through std::atomic_load/store
+  std::shared_ptr<const RankSnapshot> snapshot_;
+
+  // delta batches waiting for the background worker
+  std::mutex pending_lock_;
+  std::condition_variable pending_cv_;
+  vector<EdgeDelta> pending_;
+  unsigned int pending_batches_;
+  bool stopping_;
+  std::thread worker_;
+
+  // listening socket of run() (-1 : none) and the open connections
+  std::atomic<int> listen_fd_;
+  std::atomic<bool> stopped_;
+  std::mutex clients_lock_;
+  std::list<Client> clients_;
+
+  // Helpers :
+  // serve one client connection until it disconnects
+  void serve_client(Client* client);
+  // join the threads of the finished connections, or of all of them after
+  // shutting their sockets down
+  void join_clients(bool all);
+  // answer one request line, returns false when connection should be closed
+  bool handle_request(const string& line, vector<EdgeDelta>& batch, string& reply);
+  // queue a delta batch for the background worker
+  void submit(vector<EdgeDelta>& batch);
+  // background worker : applies pending deltas and publishes new snapshots
+  void recompute_loop();
+  // build a network from a snapshot with deltas applied
+  void rebuild(const RankSnapshot& base, const vector<EdgeDelta>& deltas, PageRank& n) const;
+
+  RankServer( const RankServer&); // copy ctor -not allowed
+  RankServer& operator=( const RankServer&); // assignment operator -not allowed
+};
+
+#endif
@@ -0,0 +1,46 @@
+/*
+ * Copyright (c) 2012 Chammika Mannakkara
+ *
+ *    SweepKernels.cpp - Implementation of the PageRank sweep row kernel
+ *
+ *    This is a part of simple tool calculate the PageRank
+ *
+ *    This source code is free software; you can redistribute it
+ *    and/or modify it in source code form under the terms of the GNU
+ *    General Public License as published by the Free Software
+ *    Foundation; either version 2 of the License, or (at your option)
+ *    any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+#include "SweepKernels.h"
+
+template<typename Real, typename Index>
+void sweep_rows(const CompressedGraph<Index>& links, const Real* scaled, Real* new_ranks,
+		Index first, Index last, rank_type decay, rank_type rank_const) {
+  const size_t* row_offsets = links.row_offsets_.data();
+  const Index* sources = links.links_.data();
+  for (Index i = first; i < last; ++i) {
+    double sum = 0.0;
+    for (size_t l = row_offsets[i]; l < row_offsets[i+1]; ++l) {
+      sum += scaled[sources[l]];
+    }
+    new_ranks[i] = rank_const + decay * sum;
+  }
+}
+
+template void sweep_rows(const CompressedGraph<unsigned int>&, const float*, float*,
+			 unsigned int, unsigned int, rank_type, rank_type);
+template void sweep_rows(const CompressedGraph<unsigned int>&, const double*, double*,
+			 unsigned int, unsigned int, rank_type, rank_type);
+template void sweep_rows(const CompressedGraph<unsigned long long>&, const float*, float*,
+			 unsigned long long, unsigned long long, rank_type, rank_type);
+template void sweep_rows(const CompressedGraph<unsigned long long>&, const double*, double*,
+			 unsigned long long, unsigned long long, rank_type, rank_type);
@@ -0,0 +1,39 @@
+/*
+ * Copyright (c) 2012 Chammika Mannakkara
+ *
+ *    SweepKernels.h - Row kernel of the pull-style PageRank sweep
+ *
+ *    This is a part of simple tool calculate the PageRank
+ *
+ *    This source code is free software; you can redistribute it
+ *    and/or modify it in source code form under the terms of the GNU
+ *    General Public License as published by the Free Software
+ *    Foundation; either version 2 of the License, or (at your option)
+ *    any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+#ifndef PAGERANK_SWEEP_KERNELS
+#define PAGERANK_SWEEP_KERNELS
+
+#include "types.h"
+#include "CompressedGraph.h"
+
+// Sweep of rows [first, last) of links :
+//   new_ranks[i] = rank_const + decay * sum of scaled[j] over the in-links j of row i
+// scaled[] holds the prescaled ranks PR(j)/L(j), sums are accumulated in double.
+// The sweep is bound by the latency of the random loads of scaled[], which
+// AVX2 / AVX-512 gathers (with or without software prefetch) did not hide
+// better than this scalar loop.
+template<typename Real, typename Index>
+void sweep_rows(const CompressedGraph<Index>& links, const Real* scaled, Real* new_ranks,
+		Index first, Index last, rank_type decay, rank_type rank_const);
+
+#endif
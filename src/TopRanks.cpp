@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2012 Chammika Mannakkara
+ *
+ *    TopRanks.cpp - Implementation of the parallel top-K selection
+ *
+ *    This is a part of simple tool calculate the PageRank
+ *
+ *    This source code is free software; you can redistribute it
+ *    and/or modify it in source code form under the terms of the GNU
+ *    General Public License as published by the Free Software
+ *    Foundation; either version 2 of the License, or (at your option)
+ *    any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+#include "TopRanks.h"
+#include "Parallel.h"
+
+TopRanks::TopRanks(size_t k, unsigned int num_threads)
+  : k_(k), num_threads_(num_threads), stable_(0), first_(true) { }
+
+// Complexity : O(N/T + (T x K) log K) per update, O(N/T x log K) at worst
+template<typename Real>
+unsigned int TopRanks::update(const Real* ranks, size_t n) {
+  typedef pair<Real, node_id_type> candidate;
+  // better ranked : higher rank, or same rank and lower ID
+  auto better = [](const candidate& a, const candidate& b) {
+    return a.first > b.first || (a.first == b.first && a.second < b.second);
+  };
+  const size_t k = std::min(k_, n);
+  const unsigned int num_threads = num_threads_;
+  vector<vector<candidate> > best( num_threads);
+
+  parallel_run(num_threads, [&](unsigned int t) {
+    vector<candidate>& heap = best[t]; // worst kept candidate at the front
+    heap.reserve( k);
+    size_t last = partition_begin(n, num_threads, t+1);
+    for (size_t i = partition_begin(n, num_threads, t); i < last; ++i) {
+      candidate c(ranks[i], i);
+      if (heap.size() < k) {
+	heap.push_back( c);
+	std::push_heap(heap.begin(), heap.end(), better);
+      }
+      else if (k && better(c, heap.front())) {
+	std::pop_heap(heap.begin(), heap.end(), better);
+	heap.back() = c;
+	std::push_heap(heap.begin(), heap.end(), better);
+      }
+    }
+  });
+
+  vector<candidate> merged;
+  for (unsigned int t = 0; t < num_threads; ++t) {
+    merged.insert(merged.end(), best[t].begin(), best[t].end());
+  }
+  std::partial_sort(merged.begin(), merged.begin() + k, merged.end(), better);
+
+  bool same = !first_ && top_.size() == k;
+  top_.resize( k);
+  for (size_t i = 0; i < k; ++i) {
+    same = same && top_[i] == merged[i].second;
+    top_[i] = merged[i].second;
+  }
+  first_ = false;
+  stable_ = same? stable_ + 1 : 0;
+  return stable_;
+}
+
+template unsigned int TopRanks::update<float>(const float* ranks, size_t n);
+template unsigned int TopRanks::update<double>(const double* ranks, size_t n);
@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2012 Chammika Mannakkara
+ *
+ *    TopRanks.h - The K highest ranked nodes of a rank vector, by parallel
+ *                 selection
+ *
+ *    This is a part of simple tool calculate the PageRank
+ *
+ *    This source code is free software; you can redistribute it
+ *    and/or modify it in source code form under the terms of the GNU
+ *    General Public License as published by the Free Software
+ *    Foundation; either version 2 of the License, or (at your option)
+ *    any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+#ifndef PAGERANK_TOP_RANKS
+#define PAGERANK_TOP_RANKS
+
+#include "types.h"
+
+// TopRanks class - the K highest ranked nodes of the successive iterates of
+// a solver, in rank order (equal ranks : lower ID first), and how many
+// updates in a row they have stayed the same, set and order (the stable
+// top-K criterion of the power iteration, --stable-top).
+// update() selects them over num_threads threads : each thread
+// keeps the K best nodes of its range in a heap, then the T x K candidates
+// are merged. Once the ranks settle, a node rarely beats the worst one kept.
+class TopRanks {
+
+public:
+  TopRanks(size_t k, unsigned int num_threads); // ctor
+
+  // top K of ranks[0 .. n), returns the number of updates in a row (this one
+  // included) with the same top K as the last one, 0 if it changed
+  template<typename Real>
+  unsigned int update(const Real* ranks, size_t n);
+
+  // IDs of the top K of the last update, best first
+  const vector<node_id_type>& top() const { return top_; }
+
+private:
+  size_t k_;
+  unsigned int num_threads_;
+  vector<node_id_type> top_;
+  unsigned int stable_;
+  bool first_;
+};
+
+#endif
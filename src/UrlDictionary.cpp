@@ -0,0 +1,150 @@
+/*
+ * Copyright (c) 2012 Chammika Mannakkara
+ *
+ *    UrlDictionary.cpp - Implementation of the fingerprint URL dictionary
+ *
+ *    This is a part of simple tool calculate the PageRank
+ *
+ *    This source code is free software; you can redistribute it
+ *    and/or modify it in source code form under the terms of the GNU
+ *    General Public License as published by the Free Software
+ *    Foundation; either version 2 of the License, or (at your option)
+ *    any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+#include <cassert>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "UrlDictionary.h"
+#include "Log.h"
+#include "defaults.h"
+
+// fingerprint of a URL : the (64-bit) standard library string hash
+static uint64_t fingerprint(std::string_view url) {
+  return std::hash<std::string_view>()(url);
+}
+
+// second, independent hash of a URL : 64-bit FNV-1a
+static uint64_t check_hash(std::string_view url) {
+  uint64_t h = 0xcbf29ce484222325ULL;
+  for (size_t i = 0; i < url.size(); ++i) {
+    h = (h ^ static_cast<unsigned char>(url[i])) * 0x100000001b3ULL;
+  }
+  return h;
+}
+
+UrlDictionary::UrlDictionary() : fd_(-1), num_urls_(0), addr_(0), length_(0) { }
+
+UrlDictionary::~UrlDictionary() {
+  if (addr_) {
+    munmap(addr_, length_);
+  }
+  if (fd_ >= 0) {
+    close( fd_);
+  }
+}
+
+bool UrlDictionary::create(const string& path) {
+  fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0666);
+  if (fd_ < 0) {
+    ERROR("Couldn't create the URL dictionary : " << path << " (" << strerror(errno) << ")" << endl);
+    return false;
+  }
+  path_ = path;
+  buffer_.reserve( URL_DICTIONARY_BUFFER_SIZE);
+  return true;
+}
+
+bool UrlDictionary::find(std::string_view url, node_id_type& id) const {
+  std::unordered_map<uint64_t, Entry>::const_iterator iter = ids_.find( fingerprint( url));
+  if (iter == ids_.end()) {
+    return false;
+  }
+  if (iter->second.check == check_hash( url)) { // same URL (both 64-bit hashes equal)
+    id = iter->second.id;
+    return true;
+  }
+  // another URL holds the fingerprint
+  map<string, node_id_type, std::less<> >::const_iterator collided = collided_.find( url);
+  if (collided == collided_.end()) {
+    return false;
+  }
+  id = collided->second;
+  return true;
+}
+
+void UrlDictionary::insert(std::string_view url, node_id_type id) {
+  assert(id == num_urls_ && "URL dictionary IDs must be issued in order");
+  assert(!addr_ && "URL dictionary is already mapped");
+  Entry entry = { check_hash( url), id };
+  if (!ids_.emplace(fingerprint( url), entry).second) {
+    PRINT(LOG_LVL_2, "URL fingerprint collision : " << url << " kept by its string" << endl);
+    collided_.emplace(string( url), id);
+  }
+  if (buffer_.size() + url.size() + 1 > buffer_.capacity() && !flush()) {
+    exit(1);
+  }
+  buffer_.insert(buffer_.end(), url.begin(), url.end());
+  buffer_.push_back('\n');
+  ++num_urls_;
+}
+
+bool UrlDictionary::flush() const {
+  size_t written = 0;
+  while (written < buffer_.size()) {
+    ssize_t n = write(fd_, buffer_.data() + written, buffer_.size() - written);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) {
+      ERROR("Couldn't write the URL dictionary : " << path_ << " (" << strerror(errno) << ")" << endl);
+      return false;
+    }
+    written += n;
+  }
+  buffer_.clear();
+  return true;
+}
+
+// Map the side file and find the start of each line : O(size of the URLs)
+void UrlDictionary::map_file() const {
+  if (!flush()) {
+    exit(1);
+  }
+  vector<char>().swap(buffer_);
+  offsets_.reserve( num_urls_ + 1);
+  offsets_.push_back( 0);
+  length_ = lseek(fd_, 0, SEEK_END);
+  if (!length_) {
+    return;
+  }
+  void* addr = mmap(0, length_, PROT_READ, MAP_SHARED, fd_, 0);
+  if (addr == MAP_FAILED) {
+    ERROR("Couldn't map the URL dictionary : " << path_ << " (" << strerror(errno) << ")" << endl);
+    exit(1);
+  }
+  addr_ = static_cast<char*>(addr);
+  madvise(addr_, length_, MADV_SEQUENTIAL);
+  for (const char* p = addr_; (p = static_cast<const char*>(memchr(p, '\n', addr_ + length_ - p))); ++p) {
+    offsets_.push_back( p - addr_ + 1);
+  }
+  madvise(addr_, length_, MADV_NORMAL);
+  PRINT(LOG_LVL_2, "URL dictionary mapped : " << offsets_.size() - 1 << " URLs, "
+	<< length_ << " bytes, " << collided_.size() << " fingerprint collision(s)" << endl);
+}
+
+std::string_view UrlDictionary::url(node_id_type id) const {
+  std::call_once(mapped_, [this] { map_file(); });
+  return std::string_view(addr_ + offsets_[id], offsets_[id + 1] - offsets_[id] - 1);
+}
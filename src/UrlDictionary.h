@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2012 Chammika Mannakkara
+ *
+ *    UrlDictionary.h - URL -> ID mapping by 64-bit fingerprints, with the
+ *                      URL strings kept in a side file
+ *
+ *    This is a part of simple tool calculate the PageRank
+ *
+ *    This source code is free software; you can redistribute it
+ *    and/or modify it in source code form under the terms of the GNU
+ *    General Public License as published by the Free Software
+ *    Foundation; either version 2 of the License, or (at your option)
+ *    any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+#ifndef PAGERANK_URL_DICTIONARY
+#define PAGERANK_URL_DICTIONARY
+
+#include <cstdint>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+
+#include "types.h"
+
+// UrlDictionary class - the URL <-> ID mappings of a Network without the URL
+// strings in memory (--url-dict). A URL is known by its 64-bit fingerprint,
+// and a second, independent 64-bit hash is kept with it to detect two URLs
+// sharing a fingerprint : the later one is then kept by its string in a
+// (small) collision map. The URLs are appended in ID order, one per line, to
+// a side file while the network is read, and the file is mmap()'ed the first
+// time a URL is asked for, ie. at the output stage.
+class UrlDictionary {
+
+public:
+  UrlDictionary(); // ctor
+  ~UrlDictionary(); // dtor - unmaps and closes the side file
+
+  // create (truncate) the side file, false on errors
+  bool create(const string& path);
+
+  // ID of a known URL, false if the URL is new
+  bool find(std::string_view url, node_id_type& id) const;
+  // add a new URL, IDs are issued in increasing order from 0
+  void insert(std::string_view url, node_id_type id);
+
+  // URL of a node : the side file is mapped on first use, no URL can be
+  // inserted after that
+  std::string_view url(node_id_type id) const;
+
+  size_t num_collisions() const { return collided_.size(); }
+  const string& path() const { return path_; }
+
+private:
+  struct Entry {
+    uint64_t check; // second hash of the URL
+    node_id_type id;
+  };
+  std::unordered_map<uint64_t, Entry> ids_; // fingerprint -> ID
+  map<string, node_id_type, std::less<> > collided_; // URLs of a taken fingerprint
+
+  string path_;
+  int fd_;
+  mutable vector<char> buffer_; // pending writes to the side file
+  node_id_type num_urls_;
+
+  // output stage : mapped side file and the offset of each URL in it
+  mutable std::once_flag mapped_;
+  mutable char* addr_;
+  mutable size_t length_;
+  mutable vector<uint64_t> offsets_;
+
+  // write the buffered URLs to the side file
+  bool flush() const;
+  void map_file() const;
+
+  UrlDictionary( const UrlDictionary&); // copy ctor -not allowed
+  UrlDictionary& operator=( const UrlDictionary&); // assignment operator -not allowed
+};
+
+#endif
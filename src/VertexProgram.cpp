@@ -0,0 +1,209 @@
+/*
+ * Copyright (c) 2012 Chammika Mannakkara
+ *
+ *    VertexProgram.cpp - Implementation of the vertex-centric iteration and
+ *                        of the link analysis score plug-ins
+ *
+ *    This is a part of simple tool calculate the PageRank
+ *
+ *    This source code is free software; you can redistribute it
+ *    and/or modify it in source code form under the terms of the GNU
+ *    General Public License as published by the Free Software
+ *    Foundation; either version 2 of the License, or (at your option)
+ *    any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+#include <chrono>
+#include <cmath>
+
+#include "VertexProgram.h"
+#include "Parallel.h"
+#include "Log.h"
+#include "defaults.h"
+
+// -- plug-ins --
+
+rank_type PageRankProgram::initial_value(node_id_type num_nodes) const {
+  return 1.0 / num_nodes;
+}
+
+void PageRankProgram::phases(node_id_type num_nodes, vector<ScorePhase>& phases) const {
+  ScorePhase rank = { 0, 0, false, true, decay_, (1 - decay_) / num_nodes, false };
+  phases.assign( 1, rank);
+}
+
+rank_type HitsProgram::initial_value(node_id_type num_nodes) const {
+  return 1.0 / sqrt((double) num_nodes); // unit 2-norm
+}
+
+void HitsProgram::phases(node_id_type, vector<ScorePhase>& phases) const {
+  ScorePhase authority = { 0, 1, false, false, 1.0, 0.0, true }; // from the hubs linking to it
+  ScorePhase hub = { 1, 0, true, false, 1.0, 0.0, true }; // from the authorities it links to
+  phases.clear();
+  phases.push_back( authority);
+  phases.push_back( hub);
+}
+
+rank_type KatzProgram::initial_value(node_id_type) const {
+  return beta_;
+}
+
+void KatzProgram::phases(node_id_type, vector<ScorePhase>& phases) const {
+  ScorePhase katz = { 0, 0, false, false, alpha_, beta_, false };
+  phases.assign( 1, katz);
+}
+
+rank_type EigenvectorProgram::initial_value(node_id_type num_nodes) const {
+  return 1.0 / sqrt((double) num_nodes);
+}
+
+void EigenvectorProgram::phases(node_id_type, vector<ScorePhase>& phases) const {
+  ScorePhase centrality = { 0, 0, false, false, 1.0, 0.0, true };
+  phases.assign( 1, centrality);
+}
+
+// -- VertexIteration --
+
+template<typename Index>
+VertexIteration<Index>::VertexIteration(const CompressedGraph<Index>& in_links,
+					unsigned int num_threads)
+  : in_links_(in_links), num_threads_(num_threads), scaled_(in_links.num_nodes()) { }
+
+// Algorithm :
+// 1. Initialize the score vectors of the program (first touched by the worker
+//    of the rows)
+// 2. Each iteration runs the phases of the program in order, a phase being one
+//    prescale pass and one sweep over the in-links or the out-links
+// 3. Check for convergence : max change of the phases of the iteration
+// Complexity : O (I x P x (N + E)), P being the number of phases
+template<typename Index>
+unsigned int VertexIteration<Index>::run(const VertexProgram& program, unsigned int iterations,
+					 rank_type epsilon, vector<vector<rank_type> >& scores) {
+  const Index N = in_links_.num_nodes();
+  vector<ScorePhase> phases;
+  program.phases(N, phases);
+  for (size_t p = 0; p < phases.size(); ++p) {
+    if (phases[p].forward && out_links_.num_nodes() != N) {
+      PRINT(LOG_LVL_2, "Building the forward link structure..." << endl);
+      transpose(in_links_, out_links_);
+    }
+  }
+
+  // 1. initial scores
+  const unsigned int num_threads = num_threads_;
+  const rank_type init = program.initial_value( N);
+  vector<Vec> values( program.num_scores(), Vec( N));
+  Vec next( N);
+  parallel_run(num_threads, [&](unsigned int t) {
+    Index last = in_links_.node_partition(num_threads, t+1);
+    for (Index j = in_links_.node_partition(num_threads, t); j < last; ++j) {
+      for (size_t s = 0; s < values.size(); ++s) values[s][j] = init;
+      next[j] = scaled_[j] = 0.0;
+    }
+  });
+
+  // 2. iterate
+  PRINT(LOG_LVL_2, "Iterating " << program.name() << " scores..." << endl);
+  unsigned int k = 0;
+  double sweep_secs = 0.0;
+  size_t swept_links = 0;
+  while (k < iterations) {
+    ++k;
+    PRINT(LOG_LVL_2, "Iteration #" << k << endl);
+    double change = 0.0;
+    for (size_t p = 0; p < phases.size(); ++p) {
+      const ScorePhase& phase = phases[p];
+      const CompressedGraph<Index>& links = phase.forward? out_links_ : in_links_;
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      step(links, phase, values[phase.from], next);
+      sweep_secs += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      swept_links += links.num_links();
+      if (phase.normalize) {
+	normalize(links, next);
+      }
+      change = std::max(change, max_change(links, next, values[phase.to]));
+      values[phase.to].swap( next);
+    }
+    // 3. convergence
+    if (epsilon != NO_CONVERGENCE_CHECK && change < epsilon) {
+      PRINT(LOG_LVL_2, "Scores converged within the given accuracy." << endl);
+      break;
+    }
+  }
+
+  if (sweep_secs > 0.0) {
+    PRINT(LOG_LVL_2, k * phases.size() << " sweeps in " << sweep_secs << " s : " 
+	  << swept_links / sweep_secs << " Edges/s" << endl);
+  }
+
+  scores.resize( values.size());
+  for (size_t s = 0; s < values.size(); ++s) {
+    scores[s].assign( values[s].begin(), values[s].end());
+  }
+  return k;
+}
+
+template<typename Index>
+void VertexIteration<Index>::step(const CompressedGraph<Index>& links, const ScorePhase& phase,
+				  const Vec& from, Vec& to) {
+  const unsigned int num_threads = num_threads_;
+  parallel_run(num_threads, [&](unsigned int t) {
+    Index last = links.node_partition(num_threads, t+1);
+    Index j = links.node_partition(num_threads, t);
+    if (phase.weighted) {
+      for (; j < last; ++j) scaled_[j] = from[j] * links.out_weight_[j]; // x(j)/L(j)
+    }
+    else {
+      std::copy(from.begin() + j, from.begin() + last, scaled_.begin() + j);
+    }
+  });
+  parallel_run(num_threads, [&](unsigned int t) {
+    sweep_rows<double, Index>(links, scaled_.data(), to.data(), links.row_partition(num_threads, t),
+			      links.row_partition(num_threads, t+1), phase.decay, phase.constant);
+  });
+}
+
+template<typename Index>
+void VertexIteration<Index>::normalize(const CompressedGraph<Index>& links, Vec& v) {
+  const unsigned int num_threads = num_threads_;
+  vector<double> sum_sq( num_threads);
+  parallel_run(num_threads, [&](unsigned int t) {
+    double sum = 0.0;
+    Index last = links.node_partition(num_threads, t+1);
+    for (Index j = links.node_partition(num_threads, t); j < last; ++j) sum += v[j] * v[j];
+    sum_sq[t] = sum;
+  });
+  double norm = sqrt( accumulate(sum_sq.begin(), sum_sq.end(), 0.0));
+  if (norm == 0.0) return;
+  parallel_run(num_threads, [&](unsigned int t) {
+    Index last = links.node_partition(num_threads, t+1);
+    for (Index j = links.node_partition(num_threads, t); j < last; ++j) v[j] /= norm;
+  });
+}
+
+template<typename Index>
+double VertexIteration<Index>::max_change(const CompressedGraph<Index>& links,
+					  const Vec& a, const Vec& b) const {
+  const unsigned int num_threads = num_threads_;
+  vector<double> change( num_threads);
+  parallel_run(num_threads, [&](unsigned int t) {
+    double max = 0.0;
+    Index last = links.node_partition(num_threads, t+1);
+    for (Index j = links.node_partition(num_threads, t); j < last; ++j) {
+      max = std::max(max, fabs(a[j] - b[j]));
+    }
+    change[t] = max;
+  });
+  return *std::max_element(change.begin(), change.end());
+}
+
+template class VertexIteration<unsigned int>;
+template class VertexIteration<unsigned long long>;
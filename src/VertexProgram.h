@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) 2012 Chammika Mannakkara
+ *
+ *    VertexProgram.h - Generic vertex-centric iteration over the link
+ *                      structure, and the link analysis scores computed
+ *                      with it (PageRank, HITS, Katz, eigenvector centrality)
+ *
+ *    This is a part of simple tool calculate the PageRank
+ *
+ *    This source code is free software; you can redistribute it
+ *    and/or modify it in source code form under the terms of the GNU
+ *    General Public License as published by the Free Software
+ *    Foundation; either version 2 of the License, or (at your option)
+ *    any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+#ifndef PAGERANK_VERTEX_PROGRAM
+#define PAGERANK_VERTEX_PROGRAM
+
+#include "types.h"
+#include "CompressedGraph.h"
+#include "SweepKernels.h"
+
+// One step of a vertex program : every node pulls the values of score vector
+// 'from' over its in-links (or its out-links if forward), and
+//   to[i] = decay * sum of from[j] (/ L(j) if weighted) + constant
+// which is one pull sweep (SweepKernels.h). With normalize, 'to' is then
+// scaled to unit 2-norm.
+struct ScorePhase {
+  unsigned int from, to;  // score vectors read and written
+  bool forward;           // pull over the out-links instead of the in-links
+  bool weighted;          // divide the value of j by its number of links
+  rank_type decay;
+  rank_type constant;
+  bool normalize;
+};
+
+// VertexProgram class - a link analysis score as a plug-in of VertexIteration :
+// its score vectors, their initial value and the phases of one iteration.
+// The phases run in order, each one reading the latest values of its 'from'
+// vector, and the iteration stops when no phase changed a score by more
+// than epsilon.
+class VertexProgram {
+
+public:
+  virtual ~VertexProgram() { }
+
+  virtual const char* name() const = 0;
+  virtual unsigned int num_scores() const { return 1; }
+  virtual const char* score_name(unsigned int /* score */) const { return name(); }
+  // the program needs the in-links with the rank leaks fixed (PageRank)
+  virtual bool leaks_fixed() const { return false; }
+
+  virtual rank_type initial_value(node_id_type num_nodes) const = 0;
+  virtual void phases(node_id_type num_nodes, vector<ScorePhase>& phases) const = 0;
+};
+
+// PageRank : PR = d * sum PR(j)/L(j) + (1-d)/N over the in-links
+class PageRankProgram : public VertexProgram {
+
+public:
+  PageRankProgram(rank_type decay) : decay_(decay) { }
+
+  const char* name() const { return "pagerank"; }
+  bool leaks_fixed() const { return true; }
+  rank_type initial_value(node_id_type num_nodes) const;
+  void phases(node_id_type num_nodes, vector<ScorePhase>& phases) const;
+
+private:
+  rank_type decay_;
+};
+
+// HITS (Kleinberg) : authority = sum of the hub values over the in-links,
+// hub = sum of the authority values over the out-links, both normalized.
+// Score 0 is the hub, score 1 the authority.
+class HitsProgram : public VertexProgram {
+
+public:
+  const char* name() const { return "hits"; }
+  unsigned int num_scores() const { return 2; }
+  const char* score_name(unsigned int score) const { return score? "authority" : "hub"; }
+  rank_type initial_value(node_id_type num_nodes) const;
+  void phases(node_id_type num_nodes, vector<ScorePhase>& phases) const;
+};
+
+// Katz centrality : x = alpha * sum x(j) over the in-links + beta. Converges
+// for alpha below 1 / (largest eigenvalue of the adjacency matrix).
+class KatzProgram : public VertexProgram {
+
+public:
+  KatzProgram(rank_type alpha, rank_type beta=1.0) : alpha_(alpha), beta_(beta) { }
+
+  const char* name() const { return "katz"; }
+  rank_type initial_value(node_id_type num_nodes) const;
+  void phases(node_id_type num_nodes, vector<ScorePhase>& phases) const;
+
+private:
+  rank_type alpha_, beta_;
+};
+
+// Eigenvector centrality : principal eigenvector of the transposed adjacency
+// matrix, x = sum x(j) over the in-links, normalized
+class EigenvectorProgram : public VertexProgram {
+
+public:
+  const char* name() const { return "eigenvector"; }
+  rank_type initial_value(node_id_type num_nodes) const;
+  void phases(node_id_type num_nodes, vector<ScorePhase>& phases) const;
+};
+
+// VertexIteration class - runs vertex programs on the in-links of a network
+// (CompressedGraph, as built for the PageRank solvers) and on its out-links,
+// built from them on first use. A step is a prescale pass and a sweep with the
+// kernels of SweepKernels.h, with the rows split over num_threads threads
+// (balanced number of links). Scores are kept in double.
+template<typename Index>
+class VertexIteration {
+
+public:
+  VertexIteration(const CompressedGraph<Index>& in_links, unsigned int num_threads); // ctor
+
+  // run program for at most iterations iterations, or until converged within
+  // epsilon (NO_CONVERGENCE_CHECK : all iterations). scores[s] receives score
+  // vector s of the program. Returns the number of iterations run.
+  unsigned int run(const VertexProgram& program, unsigned int iterations, rank_type epsilon,
+		   vector<vector<rank_type> >& scores);
+
+private:
+  typedef numa_vector<double> Vec;
+
+  const CompressedGraph<Index>& in_links_;
+  CompressedGraph<Index> out_links_; // empty until a program pulls over the out-links
+  unsigned int num_threads_;
+  Vec scaled_; // working space of step()
+
+  // to = decay * sum of from over links + constant
+  void step(const CompressedGraph<Index>& links, const ScorePhase& phase, const Vec& from, Vec& to);
+  // scale v to unit 2-norm (unless all zero)
+  void normalize(const CompressedGraph<Index>& links, Vec& v);
+  // max |a - b|
+  double max_change(const CompressedGraph<Index>& links, const Vec& a, const Vec& b) const;
+
+  VertexIteration( const VertexIteration&); // copy ctor -not allowed
+  VertexIteration& operator=( const VertexIteration&); // assignment operator -not allowed
+};
+
+#endif
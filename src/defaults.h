@@ -30,8 +30,95 @@
 // adj_list are grown at this rate
 #define DEFAULT_GROWTH_RATE  20000
 
+// build/solve phases run on a single thread unless -t is given
+#define DEFAULT_NUM_THREADS  1
+
+// --precision auto : ranks are stored in float for networks of at least
+// FLOAT_AUTO_MIN_NODES nodes, unless epsilon x N is below FLOAT_AUTO_MIN_EPSILON
+// (float resolves ranks of about 1/N to about 1e-7/N)
+#define FLOAT_AUTO_MIN_NODES   1000000
+#define FLOAT_AUTO_MIN_EPSILON 1e-5
+
+// SCC solver : a component of at least this many nodes is solved with all the
+// threads on its rows, smaller components of a level of the condensation run
+// one per thread if they add up to this many nodes
+#define SCC_PARALLEL_MIN_NODES 10000
+
+// BlockRank initial ranks : convergence of the local and host iterations
+// when no epsilon is given
+#define BLOCKRANK_EPSILON 1e-8
+
+// Krylov solvers : GMRES restarts after this many sweeps, and vector
+// operations are split over the threads for vectors of this length or more
+#define GMRES_RESTART        20
+#define KRYLOV_PARALLEL_MIN  65536
+
+// delta-PageRank solver : a round pulls over all the links when its frontier
+// and the out-links of the frontier exceed 1/DELTA_PULL_DIVISOR of the links,
+// and pushes along the out-links of the frontier otherwise
+#define DELTA_PULL_DIVISOR 20
+// and lowers its threshold by this factor when the residuals left still add
+// up to more than epsilon
+#define DELTA_THRESHOLD_DIVISOR 10
+
+// Execution planner (PageRank::make_plan()) :
+// a link from a node less than PLAN_LOCALITY_WINDOW IDs away counts as local
+#define PLAN_LOCALITY_WINDOW  4096
+// one thread of the solve per PLAN_LINKS_PER_THREAD links, at most one per core
+#define PLAN_LINKS_PER_THREAD (1 << 18)
+// BiCGSTAB instead of the power iteration (rate d) from this decay factor
+#define PLAN_KRYLOV_MIN_DECAY 0.9
+// SCC solver when no component holds more than this fraction of the nodes
+#define PLAN_SCC_MAX_LARGEST  0.5
+// PRECISION_AUTO keeps double ranks when this fraction of the links is local
+#define PLAN_FLOAT_MAX_LOCALITY 0.9
+// the working vectors of a solver may take this fraction of the free memory
+#define PLAN_MEMORY_FRACTION  0.8
+
+// power iteration extrapolation (--extrapolate) every this many steps
+#define EXTRAPOLATION_PERIOD 10
+
+// stable top-K termination (--stable-top) : iterations the top K must stay
+// unchanged (--patience)
+#define DEFAULT_STABLE_TOP_PATIENCE 5
+
+// result cache (--cache) : least recently used entries are removed while the
+// cache directory holds more than this many bytes (--cache-size, in MB)
+#define DEFAULT_CACHE_SIZE (1ULL << 30)
+
+// fingerprint URL mode (--url-dict) : URLs are written to the side file in
+// blocks of this size (bytes)
+#define URL_DICTIONARY_BUFFER_SIZE (1 << 20)
+
+// Network link sets (Arena) : first buffer of each thread, in bytes (the
+// following ones grow geometrically)
+#define ARENA_BLOCK_SIZE (1 << 20)
+// arenas cached per thread by Arena::local()
+#define ARENA_THREAD_CACHE 4
+
+// rank snapshots (--rank-snapshot) and diffs (--diff-against) are written
+// through a buffer of this size (bytes)
+#define RANK_SNAPSHOT_BUFFER_SIZE (8 << 20)
+// --diff-against : a rank changed if it moved by more than this fraction of
+// its previous value (--diff-tolerance)
+#define DEFAULT_DIFF_TOLERANCE 1e-3
+
+// run mode snapshots (--snapshots) : output files <prefix>.<edges>
+#define DEFAULT_SNAPSHOT_PREFIX "snapshot"
+
 // output message control defaults
 #define DEFAULT_LOG_LEVEL    2
 #define PROGRESS_REPORT_STEP 10000
+#define PROGRESS_REPORT_INTERVAL 1.0  // seconds, ingestion pipeline
+
+// ingestion pipeline : input is read in blocks of this size (bytes) and
+// each queue between the stages holds up to DEFAULT_QUEUE_DEPTH blocks
+#define DEFAULT_READ_BLOCK_SIZE (4 << 20)
+#define DEFAULT_QUEUE_DEPTH  8
+// concurrent build (-t > 1) : blocks of this size and queue depth. Each block
+// looks its distinct URLs up in the network once, so larger blocks repeat
+// fewer lookups ; the buffers are only touched up to the size of the input.
+#define PARALLEL_READ_BLOCK_SIZE (16 << 20)
+#define PARALLEL_QUEUE_DEPTH 2
 
 #endif
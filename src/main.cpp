@@ -2,7 +2,7 @@
  * Copyright (c) 2012 Chammika Mannakkara
  *
  *    main.cpp - Entry point to PageRank tool. Handle command-line and execute
- *               the tool in [check | run] modes
+ *               the tool in [check | run | analyze | sweep | serve] modes
  *
  *    This is a part of simple tool calculate the PageRank
  *
@@ -21,62 +21,200 @@
  *    along with this program; if not, write to the Free Software
  *    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
  */
+#include <cctype>
 #include <cmath>
+#include <cstdlib>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <sstream>
+#include <string_view>
+#include <fcntl.h>
+#include <unistd.h>
 
 #include "PageRank.h"
+#include "Server.h"
+#include "Pipeline.h"
+#include "ResultCache.h"
+#include "RankFile.h"
+#include "Parallel.h"
+#include "PerfCounters.h"
 #include "Log.h"
 #include "defaults.h"
 
+// Modes of operation of the tool
+typedef enum { CHECK_MODE, RUN_MODE, ANALYZE_MODE, SWEEP_MODE, SERVE_MODE, SNAPSHOTS_MODE } eMode;
+
+// Command line parameters of the tool
+struct CmdLine {
+  CmdLine() : net_fd(-1), mode(CHECK_MODE), decay_factor(0.0), iterations(0), 
+	      epsilon(NO_CONVERGENCE_CHECK), growth_rate(DEFAULT_GROWTH_RATE),
+	      precision(PageRank::PRECISION_DOUBLE), solver(PageRank::SOLVER_POWER), threads_set(false),
+	      precision_set(false), solver_set(false), plan(false), explain(false),
+	      jacobi(true), extrapolation(PageRank::EXTRAPOLATE_NONE), init(PageRank::INIT_UNIFORM),
+	      stable_top(0), patience(DEFAULT_STABLE_TOP_PATIENCE),
+	      cache_size(DEFAULT_CACHE_SIZE), snapshot_prefix(DEFAULT_SNAPSHOT_PREFIX),
+	      diff_tolerance(DEFAULT_DIFF_TOLERANCE) { }
+
+  int net_fd; // network file
+  eMode mode;
+  double decay_factor;
+  int iterations;
+  double epsilon;
+  unsigned int growth_rate;
+  PageRank::ePrecision precision; // storage precision of the ranks
+  PageRank::eSolver solver; // run/analyze mode only
+  bool threads_set; // -t given : the planner keeps the threads
+  bool precision_set, solver_set; // --precision, --solver given : the planner keeps them
+  bool plan; // --plan : execution planner for what was not given
+  bool explain; // run/analyze mode : print the execution plan and stop
+  bool jacobi; // Krylov solvers : Jacobi preconditioner
+  PageRank::eExtrapolation extrapolation; // power iteration
+  PageRank::eInitialRanks init; // run/analyze mode only
+  unsigned int stable_top; // power iteration : stop on a stable top K (0 : off)
+  unsigned int patience; // iterations the top K must stay unchanged
+  vector<rank_type> decay_factors; // sweep mode only
+  string socket_path; // serve mode only
+  vector<string> scores; // run mode : link analysis scores (empty : PageRank solvers)
+  string perf_export; // CSV file of the performance counters (--perf-export)
+  string cache_dir; // run/check mode result cache (empty : no cache)
+  unsigned long long cache_size; // bytes
+  string url_dictionary; // side file of the URLs (empty : URLs kept in memory)
+  vector<string> snapshots; // run mode : edge counts / fractions of the input edges
+  string snapshot_prefix; // snapshot output files : <prefix>.<edges>
+  string rank_snapshot; // run mode : binary rank snapshot written (empty : none)
+  string diff_against; // run mode : rank changes since this snapshot instead of the ranks
+  double diff_tolerance; // relative rank change reported by the diff
+};
+
 // forward declarations
 void usage(void);
-bool parse_cmdline(int argc, char *argv[], 
-		   ifstream &net_file, bool &run_mode, double &decay_factor, 
-		   int &iterations, double &epsilon, unsigned char &log_lvl,
-		   unsigned int &growth_rate);
-void read_network(PageRank& n, ifstream& net_file);
-void exec_run_mode( PageRank& n);
-void exec_check_mode(PageRank& n);
-
-// Program Globals
-unsigned char Log::level_ = DEFAULT_LOG_LEVEL;
+bool parse_cmdline(int argc, char *argv[], CmdLine &cmd);
+void read_network(PageRank& n, int net_fd);
+string cache_params(const CmdLine& cmd);
+void exec_run_mode( PageRank& n, ResultCache* cache, const CmdLine& cmd);
+void exec_scores_mode( PageRank& n, const CmdLine& cmd);
+void exec_sweep_mode( PageRank& n, const CmdLine& cmd);
+void exec_check_mode(PageRank& n, ResultCache* cache);
+void exec_analyze_mode(PageRank& n);
+void exec_snapshots_mode(PageRank& n, const CmdLine& cmd);
+void print_ranks(const PageRank& n, const vector<rank_type>& page_ranks);
+void print_leaks(const vector<Node>& leaks);
+void print_sinks(const vector<vector<Node> >& sinks);
+void serve_cached_ranks(const CacheEntry& entry);
+void serve_cached_checks(const CacheEntry& entry);
+void exec_serve_mode(PageRank& n, const CmdLine& cmd);
 
 
 int main(int argc, char *argv[]) {
 
-  ifstream net_file;
-  bool run_mode = false;
-  double decay_factor = 0.0 ;
-  int iterations = 0;
-  double epsilon = NO_CONVERGENCE_CHECK;
-  unsigned int growth_rate = DEFAULT_GROWTH_RATE;
+  CmdLine cmd;
 
-  bool parsed = parse_cmdline( argc, argv, 
-			       net_file, run_mode, decay_factor, iterations, epsilon, Log::level_,
-			       growth_rate);
+  bool parsed = parse_cmdline( argc, argv, cmd);
   if (!parsed) {
     usage();
     exit(0);
   }
 
-  // create PageRank object
-  PageRank n(decay_factor, iterations, epsilon, growth_rate);
+  if (Numa::enabled_) {
+    PRINT(LOG_LVL_2, "NUMA mode : " << Numa::num_nodes() << " node(s), " 
+	  << Parallel::num_threads_ << " pinned thread(s)" << endl);
+  }
+
+  // counters are opened before any thread is started, to be inherited by all
+  if (PerfCounters::enabled_) {
+    PerfCounters::open();
+  }
+
+  // a result of a previous run on the same network and parameters is served
+  // from the cache without reading the network
+  std::unique_ptr<ResultCache> cache;
+  // (run mode : the full list of ranks only, of a fixed solver and precision :
+  // the planner picks them from the network and from the free memory and
+  // cores of the machine at run time, which the key can't tell)
+  const bool planned = (cmd.solver == PageRank::SOLVER_AUTO || cmd.precision == PageRank::PRECISION_AUTO);
+  if (!cmd.cache_dir.empty() && cmd.mode == RUN_MODE && planned) {
+    PRINT(LOG_LVL_2, "Result cache not used : the solver or precision is planned" << endl);
+  }
+  if (!cmd.cache_dir.empty() && ((cmd.mode == RUN_MODE && cmd.scores.empty() && cmd.rank_snapshot.empty() &&
+				  cmd.diff_against.empty() && !planned) || cmd.mode == CHECK_MODE)) {
+    cache.reset( new ResultCache(cmd.cache_dir, cmd.cache_size));
+    if (!cache->open(cmd.net_fd, cache_params(cmd))) {
+      cache.reset();
+    }
+    else {
+      CacheEntry entry;
+      if (cache->lookup( entry)) {
+	PRINT(LOG_LVL_2, "Result cache hit : " << cache->path() << endl);
+	close( cmd.net_fd);
+	if (cmd.mode == RUN_MODE) {
+	  serve_cached_ranks( entry);
+	}
+	else {
+	  serve_cached_checks( entry);
+	}
+	return 0;
+      }
+      PRINT(LOG_LVL_2, "Result cache miss : " << cache->path() << endl);
+    }
+  }
 
+  // create PageRank object
+  PageRank n(cmd.decay_factor, cmd.iterations, cmd.epsilon, cmd.growth_rate);
+  n.set_precision( cmd.precision);
+  n.set_solver( cmd.solver);
+  n.set_auto_threads( cmd.plan && !cmd.threads_set);
+  n.set_initial_ranks( cmd.init);
+  n.set_jacobi( cmd.jacobi);
+  n.set_extrapolation( cmd.extrapolation);
+  n.set_stable_top(cmd.stable_top, cmd.patience);
+  if (!cmd.url_dictionary.empty() && !n.set_url_dictionary( cmd.url_dictionary)) {
+    exit(1);
+  }
 
-  read_network(n, net_file);
-  if (run_mode) {
-    exec_run_mode( n);
+  if (cmd.mode != SNAPSHOTS_MODE) { // snapshots : the network is read as the snapshots go
+    read_network(n, cmd.net_fd);
   }
-  else { // check mode
-    exec_check_mode( n);
+  if (cmd.explain) {
+    n.plan_PageRanks();
+    if (Log::level_ < LOG_LVL_2) { // else logged already
+      cout << n.plan();
+    }
+    return 0;
+  }
+  switch (cmd.mode) {
+  case SNAPSHOTS_MODE :
+    exec_snapshots_mode( n, cmd); break;
+  case RUN_MODE :
+    if (cmd.scores.empty()) exec_run_mode( n, cache.get(), cmd);
+    else exec_scores_mode( n, cmd);
+    break;
+  case ANALYZE_MODE :
+    exec_analyze_mode( n); break;
+  case SWEEP_MODE :
+    exec_sweep_mode( n, cmd); break;
+  case SERVE_MODE :
+    exec_serve_mode( n, cmd); break;
+  default : // check mode
+    exec_check_mode( n, cache.get());
+  }
+  if (PerfCounters::enabled_ && !cmd.perf_export.empty()) {
+    PerfCounters::export_csv( cmd.perf_export);
   }
 
 }
 
-// Reads a Network from input stream
-// using the stream extraction operator for Network class
-void read_network(PageRank& n, ifstream& net_file) {
+// Reads a Network from the network file (plain or compressed, see InputStream)
+// through the staged ingestion pipeline (IngestPipeline)
+void read_network(PageRank& n, int net_fd) {
   PRINT(LOG_LVL_1, "Reading Network..."<< endl);
-  net_file >> n; // read in network
+  bool read_ok = load_network(n, net_fd, Parallel::num_threads_);
+  close( net_fd);
+  if (!read_ok) {
+    ERROR("Couldn't read the network file" << endl);
+    exit(1);
+  }
   PRINT(LOG_LVL_1, "Network Reading complete." << endl);
 
   PRINT(LOG_LVL_1, "Number of Nodes = " << n.num_nodes() << endl);
@@ -85,18 +223,58 @@ void read_network(PageRank& n, ifstream& net_file) {
   PRINT(LOG_LVL_3, n) ; // cout << n; // check network
 }
 
+// Key parameters of the result cache : the mode and every parameter its
+// result depends on (not the threads or log level). The solver and precision
+// are never auto here (no cache with the planner).
+string cache_params(const CmdLine& cmd) {
+  std::ostringstream params;
+  params.precision( 17);
+  if (cmd.mode == RUN_MODE) {
+    params << "run decay=" << cmd.decay_factor << " iterations=" << cmd.iterations
+	   << " epsilon=" << cmd.epsilon << " precision=" << cmd.precision
+	   << " solver=" << cmd.solver << " jacobi=" << cmd.jacobi
+	   << " extrapolation=" << cmd.extrapolation << " init=" << cmd.init;
+    if (cmd.stable_top) {
+      params << " stable_top=" << cmd.stable_top << " patience=" << cmd.patience;
+    }
+  }
+  else {
+    params << "check";
+  }
+  return params.str();
+}
+
 // Run mode of the PageRank calculation tool
-// Computes the PageRanks and output them using the ID -> Node mapping
-void exec_run_mode( PageRank& n) {
+// Computes the PageRanks and output them using the ID -> Node mapping, or
+// only their changes since a previous rank snapshot (--diff-against). The
+// previous snapshot is mapped before the new one is written, so both may be
+// the same file.
+void exec_run_mode( PageRank& n, ResultCache* cache, const CmdLine& cmd) {
+  RankFile previous;
+  if (!cmd.diff_against.empty() && !previous.map( cmd.diff_against)) {
+    exit(1);
+  }
   PRINT(LOG_LVL_1, "Finding PageRanks... " << endl); 
   const vector<rank_type>& page_ranks = n.calculate_PageRanks();
   PRINT(LOG_LVL_1, "PageRank computation complete." << endl);
 
-  const map<node_id_type, Node>& mapping = n.get_id_2_node_map();
-  PRINT(LOG_LVL_1, "PageRanks :" << endl);
-  for (unsigned int node=0; node< page_ranks.size(); ++node) {
-    out_citer node_iter = mapping.find( node);
-    PRINT(LOG_LVL_1, page_ranks[node] << '\t' << node_iter->second.url() << endl);
+  if (cmd.diff_against.empty()) {
+    print_ranks(n, page_ranks);
+  }
+  else if (Log::level_ >= LOG_LVL_1) {
+    PRINT(LOG_LVL_1, "PageRank changes since " << cmd.diff_against << " :" << endl);
+    RankDiff diff;
+    if (!diff_ranks(previous, n, page_ranks, cmd.diff_tolerance, *Log::out_, diff)) {
+      exit(1);
+    }
+    PRINT(LOG_LVL_2, diff.changed << " changed, " << diff.added << " added, " << diff.removed
+	  << " removed, " << diff.unchanged << " unchanged node(s)" << endl);
+  }
+  if (!cmd.rank_snapshot.empty() && !RankFile::write(cmd.rank_snapshot, page_ranks, n)) {
+    exit(1);
+  }
+  if (cache) {
+    cache->store_ranks(page_ranks, n);
   }
 #ifndef NDEBUG
   // Check summation of PageRanks
@@ -107,27 +285,213 @@ void exec_run_mode( PageRank& n) {
 
 }
 
+// Output the PageRanks using the ID -> Node mapping
+void print_ranks(const PageRank& n, const vector<rank_type>& page_ranks) {
+  PRINT(LOG_LVL_1, "PageRanks :" << endl);
+  for (node_id_type node=0; node< page_ranks.size(); ++node) {
+    PRINT(LOG_LVL_1, page_ranks[node] << '\t' << n.url( node) << endl);
+  }
+}
+
+// Analyze mode of the PageRank calculation tool
+// Finds the rank leaks and sinks on a thread of its own while the PageRanks
+// are computed (on Parallel::num_threads_ threads) from the same loaded
+// network : the solvers only read the Network, which is kept for the
+// diagnostics. Both results are output when both are done.
+void exec_analyze_mode( PageRank& n) {
+  PRINT(LOG_LVL_1, "Finding rank leaks, rank sinks and PageRanks... " << endl); 
+  n.set_keep_graph( true);
+  vector<Node> ln;
+  vector<vector<Node> > ls;
+  std::thread diagnostics([&n, &ln, &ls] {
+    n.find_rank_leaks( ln);
+    n.find_rank_sinks( ls);
+  });
+  const vector<rank_type>& page_ranks = n.calculate_PageRanks();
+  diagnostics.join();
+  PRINT(LOG_LVL_1, "Analysis complete." << endl);
+
+  print_leaks( ln);
+  print_sinks( ls);
+  print_ranks(n, page_ranks);
+}
+
+// Position in text after count edges (pairs of URL tokens, as read by
+// Network::tokenize) from position pos, or the end of the text. edges
+// receives the number of edges skipped.
+static size_t skip_edges(const string& text, size_t pos, edge_count_type count, edge_count_type& edges) {
+  const size_t length = text.size();
+  size_t tokens = 0;
+  edges = 0;
+  while (edges < count) {
+    while (pos != length && isspace(static_cast<unsigned char>(text[pos]))) ++pos;
+    if (pos == length) break;
+    while (pos != length && !isspace(static_cast<unsigned char>(text[pos]))) ++pos;
+    if (++tokens % 2 == 0) ++edges;
+  }
+  return pos;
+}
+
+// Run mode with --snapshots : the network file is read once, and its edges
+// are added in input order up to each checkpoint (an edge count, or a
+// fraction of the input edges if given with a decimal point), where the
+// PageRanks of the network so far are computed and written to
+// <prefix>.<edges>. The Network is extended in place from one snapshot to
+// the next and the solvers start from the ranks of the previous snapshot.
+// The back node sets are released after the first snapshot : the leak fixing
+// links are found again from the adjacency list for each later one.
+void exec_snapshots_mode(PageRank& n, const CmdLine& cmd) {
+  PRINT(LOG_LVL_1, "Reading Network..."<< endl);
+  std::unique_ptr<InputStream> input = InputStream::open(cmd.net_fd, Parallel::num_threads_);
+  if (!input) {
+    exit(1);
+  }
+  string text;
+  IngestPipeline pipeline( *input);
+  bool read_ok = pipeline.read_all( text);
+  close( cmd.net_fd);
+  if (!read_ok) {
+    ERROR("Couldn't read the network file" << endl);
+    exit(1);
+  }
+  edge_count_type total_edges;
+  skip_edges(text, 0, ~0ULL, total_edges);
+  PRINT(LOG_LVL_1, "Network Reading complete." << endl);
+  PRINT(LOG_LVL_1, "Number of input Edges = " << total_edges << endl);
+
+  vector<edge_count_type> checkpoints;
+  for (const string& snapshot : cmd.snapshots) {
+    edge_count_type edges = (snapshot.find('.') != string::npos)?
+      (edge_count_type) (atof(snapshot.c_str()) * total_edges + 0.5) : strtoull(snapshot.c_str(), 0, 10);
+    checkpoints.push_back( std::min(edges, total_edges));
+  }
+  sort(checkpoints.begin(), checkpoints.end()); // a repeated checkpoint recomputes the same network
+
+  n.set_warm_start( true);
+  size_t pos = 0;
+  edge_count_type edges_read = 0;
+  for (size_t s = 0; s < checkpoints.size(); ++s) {
+    edge_count_type edges;
+    size_t end = skip_edges(text, pos, checkpoints[s] - edges_read, edges);
+    n.add_edges_parallel(text.data() + pos, end - pos, Parallel::num_threads_);
+    pos = end;
+    edges_read += edges;
+    PRINT(LOG_LVL_1, "Snapshot #" << s << " : " << edges_read << " input Edges, " << n.num_nodes()
+	  << " Nodes, " << n.num_edges() << " Edges" << endl);
+    if (!n.num_nodes()) {
+      continue;
+    }
+
+    PRINT(LOG_LVL_1, "Finding PageRanks... " << endl); 
+    const vector<rank_type>& page_ranks = n.calculate_PageRanks();
+    PRINT(LOG_LVL_1, "PageRank computation complete." << endl);
+
+    std::ostringstream path;
+    path << cmd.snapshot_prefix << '.' << edges_read;
+    ofstream out( path.str().c_str());
+    for (node_id_type node=0; node < page_ranks.size(); ++node) {
+      out << page_ranks[node] << '\t' << n.url( node) << '\n';
+    }
+    if (!out.flush()) {
+      ERROR("Couldn't write the snapshot to " << path.str() << endl);
+      exit(1);
+    }
+    PRINT(LOG_LVL_1, "PageRanks written to " << path.str() << endl);
+  }
+}
+
+// Run mode with --score : computes the link analysis scores of the listed
+// vertex programs on one load of the network and output them as one column
+// per score (HITS gives two : hub and authority). The decay factor is the
+// PageRank decay and the Katz attenuation factor.
+void exec_scores_mode( PageRank& n, const CmdLine& cmd) {
+  vector<std::unique_ptr<VertexProgram> > programs;
+  for (const string& score : cmd.scores) {
+    if (score == "pagerank") programs.emplace_back( new PageRankProgram(cmd.decay_factor));
+    else if (score == "hits") programs.emplace_back( new HitsProgram());
+    else if (score == "katz") programs.emplace_back( new KatzProgram(cmd.decay_factor));
+    else programs.emplace_back( new EigenvectorProgram());
+  }
+  vector<const VertexProgram*> program_list;
+  for (const std::unique_ptr<VertexProgram>& program : programs) {
+    program_list.push_back( program.get());
+  }
+  PRINT(LOG_LVL_1, "Finding scores... " << endl); 
+  vector<vector<rank_type> > scores;
+  n.calculate_scores(program_list, scores);
+  PRINT(LOG_LVL_1, "Score computation complete." << endl);
+
+  PRINT(LOG_LVL_1, "Scores :");
+  for (const VertexProgram* program : program_list) {
+    for (unsigned int s = 0; s < program->num_scores(); ++s) {
+      PRINT(LOG_LVL_1, ' ' << program->score_name( s));
+    }
+  }
+  PRINT(LOG_LVL_1, endl);
+  for (node_id_type node=0; node < n.num_nodes(); ++node) {
+    for (unsigned int v = 0; v < scores.size(); ++v) {
+      PRINT(LOG_LVL_1, scores[v][node] << '\t');
+    }
+    PRINT(LOG_LVL_1, n.url( node) << endl);
+  }
+}
+
+// Sweep mode of the PageRank calculation tool
+// Computes the PageRanks for a list of decay factors in one go and output them
+// as one column per decay factor
+void exec_sweep_mode( PageRank& n, const CmdLine& cmd) {
+  PRINT(LOG_LVL_1, "Finding PageRanks... " << endl); 
+  vector<vector<rank_type> > page_ranks;
+  n.calculate_PageRanks(cmd.decay_factors, page_ranks);
+  PRINT(LOG_LVL_1, "PageRank computation complete." << endl);
+
+  PRINT(LOG_LVL_1, "PageRanks for decay factors :");
+  for (unsigned int v = 0; v < cmd.decay_factors.size(); ++v) {
+    PRINT(LOG_LVL_1, ' ' << cmd.decay_factors[v]);
+  }
+  PRINT(LOG_LVL_1, endl);
+  for (node_id_type node=0; node < n.num_nodes(); ++node) {
+    for (unsigned int v = 0; v < page_ranks.size(); ++v) {
+      PRINT(LOG_LVL_1, page_ranks[v][node] << '\t');
+    }
+    PRINT(LOG_LVL_1, n.url( node) << endl);
+  }
+}
+
 // Check mode of the PageRank calculation tool
 // Find rank leaks and rank sinks and output the groups
-void exec_check_mode(PageRank& n) {
+void exec_check_mode(PageRank& n, ResultCache* cache) {
   vector<Node> ln;
-  ostream_iterator<Node> output (cout,"\n");
-    
   PRINT(LOG_LVL_1, "Finding rank leaks... " << endl);
-  bool leaks_found = n.find_rank_leaks(ln);
-  if (leaks_found) {
+  n.find_rank_leaks(ln);
+  print_leaks(ln);
+  
+  vector<vector<Node> > ls;
+  PRINT(LOG_LVL_1, "Finding rank sinks... " << endl);
+  n.find_rank_sinks(ls);
+  print_sinks(ls);
+
+  if (cache) {
+    cache->store_checks(ln, ls);
+  }
+}
+
+// Output the rank leaks
+void print_leaks(const vector<Node>& ln) {
+  ostream_iterator<Node> output (cout,"\n");
+  if (!ln.empty()) {
     PRINT(LOG_LVL_1, "Leaks : there are " << ln.size() << " leak node(s) " << endl);
     copy ( ln.begin(), ln.end(), output );
   }
   else {
     PRINT(LOG_LVL_1, "No PageRank leaks were found in the network" << endl);
   }
-  
-  vector<vector<Node> > ls;
-  
-  PRINT(LOG_LVL_1, "Finding rank sinks... " << endl);
-  bool sinks_found = n.find_rank_sinks(ls);
-  if (sinks_found) {
+}
+
+// Output the rank sink groups
+void print_sinks(const vector<vector<Node> >& ls) {
+  ostream_iterator<Node> output (cout,"\n");
+  if (!ls.empty()) {
     PRINT(LOG_LVL_1, "Sinks : there are " << ls.size() << " sink group(s) " << endl);
     for (unsigned int i = 0; i < ls.size(); ++i) {
       PRINT(LOG_LVL_1, "Sink Group #" << i << endl); 
@@ -139,43 +503,134 @@ void exec_check_mode(PageRank& n) {
   }
 }
 
+// Run mode result from the cache : ranks and URLs are read from the mapped entry
+void serve_cached_ranks(const CacheEntry& entry) {
+  PRINT(LOG_LVL_1, "PageRanks :" << endl);
+  const rank_type* page_ranks = entry.values();
+  for (size_t node = 0; node < entry.num_values(); ++node) {
+    pair<const char*, size_t> url = entry.str( node);
+    PRINT(LOG_LVL_1, page_ranks[node] << '\t' << std::string_view(url.first, url.second) << endl);
+  }
+}
+
+// Check mode result from the cache, in the output format of exec_check_mode
+void serve_cached_checks(const CacheEntry& entry) {
+  size_t num_leaks = entry.group_begin( 1);
+  if (num_leaks) {
+    PRINT(LOG_LVL_1, "Leaks : there are " << num_leaks << " leak node(s) " << endl);
+    for (size_t i = 0; i < num_leaks; ++i) {
+      pair<const char*, size_t> node = entry.str( i);
+      cout << std::string_view(node.first, node.second) << '\n';
+    }
+  }
+  else {
+    PRINT(LOG_LVL_1, "No PageRank leaks were found in the network" << endl);
+  }
+  size_t num_sinks = entry.num_groups() - 1;
+  if (num_sinks) {
+    PRINT(LOG_LVL_1, "Sinks : there are " << num_sinks << " sink group(s) " << endl);
+    for (size_t g = 1; g <= num_sinks; ++g) {
+      PRINT(LOG_LVL_1, "Sink Group #" << g - 1 << endl); 
+      for (size_t i = entry.group_begin( g); i < entry.group_begin( g + 1); ++i) {
+	pair<const char*, size_t> node = entry.str( i);
+	cout << std::string_view(node.first, node.second) << '\n';
+      }
+    }
+  }
+  else {
+    PRINT(LOG_LVL_1, "No PageRank sinks were found in the network" << endl);
+  }
+}
+
+// Serve mode of the PageRank calculation tool
+// Computes the PageRanks once and answers queries on a Unix domain socket
+// until the process is terminated
+void exec_serve_mode(PageRank& n, const CmdLine& cmd) {
+  RankServer server( n);
+  PRINT(LOG_LVL_1, "Finding PageRanks... " << endl); 
+  server.publish( n);
+  PRINT(LOG_LVL_1, "PageRank computation complete." << endl);
+  if (!server.run( cmd.socket_path)) {
+    exit(1);
+  }
+}
+
 // Usage description
 void usage(void) {
   PRINT(LOG_LVL_1, "Usage:" << endl);
-  PRINT(LOG_LVL_1, "pagerank <network_file> check [-l <log_level>] [-g growth_rate]" << endl);
+  PRINT(LOG_LVL_1, "pagerank <network_file> check [-l <log_level>] [-g growth_rate] [-t threads]\n"
+                   "         [--cache <dir>] [--cache-size <MB>] [--url-dict <file>]\n"
+                   "         [--perf] [--perf-export <csv_file>]" << endl);
   PRINT(LOG_LVL_1, "OR" << endl);
   PRINT(LOG_LVL_1, "pagerank <network_file> run <decay_factor> <iterations>\n" 
-                   "         [-e <epsilon>] [-l <log_level>] [-g growth_rate]" << endl) ;
+                   "         [-e <epsilon>] [-l <log_level>] [-g growth_rate] [-t threads]\n"
+                   "         [--precision float|double|auto]\n"
+                   "         [--numa] [--solver auto|power|scc|gmres|bicgstab|delta] [--precond jacobi|none]\n"
+                   "         [--plan] [--explain]\n"
+                   "         [--init uniform|blockrank] [--extrapolate none|aitken|quadratic]\n"
+                   "         [--stable-top <K> [--patience <iterations>]]\n"
+                   "         [--cache <dir>] [--cache-size <MB>] [--url-dict <file>]\n"
+                   "         [--score pagerank|hits|katz|eigenvector[,...]]\n"
+                   "         [--snapshots <edges>|<fraction>[,...] [--snapshot-prefix <path>]]\n"
+                   "         [--rank-snapshot <file>] [--diff-against <file> [--diff-tolerance <relative>]]\n"
+                   "         [--perf] [--perf-export <csv_file>]" << endl) ;
+  PRINT(LOG_LVL_1, "OR" << endl);
+  PRINT(LOG_LVL_1, "pagerank <network_file> analyze <decay_factor> <iterations>\n" 
+                   "         [run mode options]" << endl) ;
+  PRINT(LOG_LVL_1, "OR" << endl);
+  PRINT(LOG_LVL_1, "pagerank <network_file> sweep <decay_factor>[,<decay_factor>...] <iterations>\n" 
+                   "         [-e <epsilon>] [-l <log_level>] [-g growth_rate] [-t threads]\n"
+                   "         [--numa] [--url-dict <file>]" << endl) ;
+  PRINT(LOG_LVL_1, "OR" << endl);
+  PRINT(LOG_LVL_1, "pagerank <network_file> serve <decay_factor> <iterations> <socket_path>\n" 
+                   "         [-e <epsilon>] [-l <log_level>] [-g growth_rate] [-t threads]" << endl) ;
 }
 
 // simple commandline parser - not much checking
 // user is expected to give sane cmdline arguments
 // returns -true if cmdline is successfully parsed 
-bool parse_cmdline(int argc, char *argv[], 
-		   ifstream &net_file, bool &run_mode, double &decay_factor, 
-		   int &iterations, double &epsilon, unsigned char &log_lvl, 
-		   unsigned int &growth_rate) {
-  if (argc < 3 || argc > 11)
+bool parse_cmdline(int argc, char *argv[], CmdLine &cmd) {
+  if (argc < 3)
     return false;
 
-  net_file.open(argv[1],  ifstream::in);
-  if (!net_file.is_open()) {
-    ERROR("Couldn't open file : " << argv[1] << endl);
+  cmd.net_fd = open(argv[1], O_RDONLY);
+  if (cmd.net_fd < 0) {
+    ERROR("Couldn't open file : " << argv[1] << " (" << strerror(errno) << ")" << endl);
     return false;    
   }
 
   int opt_args = 0;
-  if (string(argv[2]) == "run") { // run mode
-    run_mode= true;
-    if (argc < 5) // not enough arguments for run mode
+  string mode = argv[2];
+  if (mode == "run" || mode == "analyze" || mode == "serve") { // run/analyze/serve mode
+    cmd.mode= (mode == "run")? RUN_MODE : (mode == "analyze")? ANALYZE_MODE : SERVE_MODE;
+    if (argc < ((cmd.mode == SERVE_MODE)? 6 : 5)) // not enough arguments for run/analyze/serve mode
+      return false;
+    // get mandetory parameters <decay_factor> <iterations> [<socket_path>]
+    cmd.decay_factor = atof(argv[3]);
+    cmd.iterations = atoi(argv[4]);
+    opt_args= 5; // from 5
+    if (cmd.mode == SERVE_MODE) {
+      cmd.socket_path = argv[5];
+      opt_args= 6; // from 6
+    }
+  }
+  else if (mode == "sweep") { // sweep mode
+    cmd.mode= SWEEP_MODE;
+    if (argc < 5) // not enough arguments for sweep mode
       return false;
-    // get mandetory parameters run <decay_factor> <iterations>
-    decay_factor = atof(argv[3]);
-    iterations = atoi(argv[4]);
+    // get mandetory parameters sweep <decay_factor>,<decay_factor>.. <iterations>
+    for (char* p = argv[3]; *p; ) {
+      char* end;
+      cmd.decay_factors.push_back( strtod(p, &end));
+      if (end == p || (*end && *end != ','))
+	return false;
+      p = *end? end + 1 : end;
+    }
+    cmd.iterations = atoi(argv[4]);
     opt_args= 5; // from 5
   }
-  else if (string(argv[2]) == "check") { // check mode
-    run_mode= false;
+  else if (mode == "check") { // check mode
+    cmd.mode= CHECK_MODE;
     opt_args= 3; // from 3
   }
   else { // unknown mode
@@ -183,18 +638,162 @@ bool parse_cmdline(int argc, char *argv[],
   }
   // iterate over optional parameters
   for (int i=opt_args; i < argc; i+= 2) { 
+    string opt = argv[i];
+    if (opt == "--numa") { // flag : no value
+      Numa::enabled_ = true;
+      --i;
+      continue;
+    }
+    if (opt == "--plan") { // flag : no value
+      cmd.plan = true;
+      --i;
+      continue;
+    }
+    if (opt == "--explain") { // flag : no value
+      cmd.explain = true;
+      --i;
+      continue;
+    }
+    if (opt == "--perf") { // flag : no value
+      PerfCounters::enabled_ = true;
+      --i;
+      continue;
+    }
     if (argc < i+2) // missing parameters
       return false; 
-    switch(argv[i][1]) {
-    case 'e' :
-      epsilon = atof(argv[i+1]); break;
-    case 'l' :
-      log_lvl = atoi(argv[i+1]); break;
-    case 'g' :
-      growth_rate = atoi(argv[i+1]); break;
-    default:
+    if (opt == "-e") {
+      cmd.epsilon = atof(argv[i+1]);
+    }
+    else if (opt == "-l") {
+      Log::level_ = atoi(argv[i+1]);
+    }
+    else if (opt == "-g") {
+      cmd.growth_rate = atoi(argv[i+1]);
+    }
+    else if (opt == "--precision") {
+      string precision = argv[i+1];
+      if (precision == "float") cmd.precision = PageRank::PRECISION_FLOAT;
+      else if (precision == "double") cmd.precision = PageRank::PRECISION_DOUBLE;
+      else if (precision == "auto") cmd.precision = PageRank::PRECISION_AUTO;
+      else return false;
+      cmd.precision_set = true;
+    }
+    else if (opt == "--solver") {
+      string solver = argv[i+1];
+      if (solver == "power") cmd.solver = PageRank::SOLVER_POWER;
+      else if (solver == "scc") cmd.solver = PageRank::SOLVER_SCC;
+      else if (solver == "gmres") cmd.solver = PageRank::SOLVER_GMRES;
+      else if (solver == "bicgstab") cmd.solver = PageRank::SOLVER_BICGSTAB;
+      else if (solver == "delta") cmd.solver = PageRank::SOLVER_DELTA;
+      else if (solver == "auto") cmd.solver = PageRank::SOLVER_AUTO;
+      else return false;
+      cmd.solver_set = true;
+    }
+    else if (opt == "--precond") {
+      string precond = argv[i+1];
+      if (precond == "jacobi") cmd.jacobi = true;
+      else if (precond == "none") cmd.jacobi = false;
+      else return false;
+    }
+    else if (opt == "--extrapolate") {
+      string extrapolation = argv[i+1];
+      if (extrapolation == "none") cmd.extrapolation = PageRank::EXTRAPOLATE_NONE;
+      else if (extrapolation == "aitken") cmd.extrapolation = PageRank::EXTRAPOLATE_AITKEN;
+      else if (extrapolation == "quadratic") cmd.extrapolation = PageRank::EXTRAPOLATE_QUADRATIC;
+      else return false;
+    }
+    else if (opt == "--init") {
+      string init = argv[i+1];
+      if (init == "uniform") cmd.init = PageRank::INIT_UNIFORM;
+      else if (init == "blockrank") cmd.init = PageRank::INIT_BLOCKRANK;
+      else return false;
+    }
+    else if (opt == "--stable-top") {
+      cmd.stable_top = atoi(argv[i+1]);
+      if (!cmd.stable_top)
+	return false;
+    }
+    else if (opt == "--patience") {
+      cmd.patience = atoi(argv[i+1]);
+      if (!cmd.patience)
+	return false;
+    }
+    else if (opt == "--score") {
+      std::istringstream list( argv[i+1]);
+      string score;
+      while (std::getline(list, score, ',')) {
+	if (score != "pagerank" && score != "hits" && score != "katz" && score != "eigenvector")
+	  return false;
+	cmd.scores.push_back( score);
+      }
+    }
+    else if (opt == "--perf-export") {
+      PerfCounters::enabled_ = true;
+      cmd.perf_export = argv[i+1];
+    }
+    else if (opt == "--cache") {
+      cmd.cache_dir = argv[i+1];
+    }
+    else if (opt == "--snapshots") {
+      std::istringstream list( argv[i+1]);
+      string snapshot;
+      while (std::getline(list, snapshot, ',')) {
+	if (snapshot.empty() || snapshot.find_first_not_of("0123456789.") != string::npos)
+	  return false;
+	cmd.snapshots.push_back( snapshot);
+      }
+    }
+    else if (opt == "--snapshot-prefix") {
+      cmd.snapshot_prefix = argv[i+1];
+    }
+    else if (opt == "--rank-snapshot") {
+      cmd.rank_snapshot = argv[i+1];
+    }
+    else if (opt == "--diff-against") {
+      cmd.diff_against = argv[i+1];
+    }
+    else if (opt == "--diff-tolerance") {
+      cmd.diff_tolerance = atof(argv[i+1]);
+    }
+    else if (opt == "--url-dict") {
+      cmd.url_dictionary = argv[i+1];
+    }
+    else if (opt == "--cache-size") {
+      cmd.cache_size = strtoull(argv[i+1], 0, 10) << 20;
+    }
+    else if (opt == "-t") {
+      Parallel::num_threads_ = atoi(argv[i+1]); 
+      if (!Parallel::num_threads_) 
+	return false;
+      cmd.threads_set = true;
+    }
+    else {
       return false;
     }
   }
+  if (cmd.explain && cmd.mode != RUN_MODE && cmd.mode != ANALYZE_MODE) {
+    return false;
+  }
+  if (cmd.mode == SWEEP_MODE && (cmd.precision_set || cmd.plan)) { // double ranks, K interleaved
+    return false;
+  }
+  if (cmd.plan) { // the planner chooses what was not given
+    if (!cmd.solver_set) cmd.solver = PageRank::SOLVER_AUTO;
+    if (!cmd.precision_set) cmd.precision = PageRank::PRECISION_AUTO;
+  }
+  if (cmd.stable_top) { // power iteration of the run/analyze modes only
+    if ((cmd.mode != RUN_MODE && cmd.mode != ANALYZE_MODE) || 
+	(cmd.solver != PageRank::SOLVER_POWER && cmd.solver != PageRank::SOLVER_AUTO))
+      return false;
+  }
+  if (!cmd.rank_snapshot.empty() || !cmd.diff_against.empty()) { // run mode PageRanks only
+    if (cmd.mode != RUN_MODE || !cmd.scores.empty() || !cmd.snapshots.empty())
+      return false;
+  }
+  if (!cmd.snapshots.empty()) { // run mode PageRanks only, nodes are added after the output
+    if (cmd.mode != RUN_MODE || !cmd.scores.empty() || !cmd.url_dictionary.empty())
+      return false;
+    cmd.mode = SNAPSHOTS_MODE;
+  }
   return true;
 }
@@ -26,6 +26,7 @@
 
 #include <vector>
 #include <map>
+#include <memory_resource>
 #include <list>
 #include <set>
 #include <queue>
@@ -65,7 +66,16 @@ using std::set_union;
 using std::equal;
 
 // Node ID type
+// 32-bit IDs by default. Networks of more than 2^32 nodes need a build with
+// 64-bit IDs (make WIDE_IDS=yes), which makes the build containers larger.
+#ifdef PAGERANK_WIDE_IDS
+typedef unsigned long long node_id_type;
+#else
 typedef unsigned int node_id_type; 
+#endif
+
+// Edge count type : always 64-bit, a network may have more than 2^32 edges
+typedef unsigned long long edge_count_type;
 
 // Attributes attached to edge of Network
 // This can be of any class(object) containing more infomation
@@ -82,19 +92,25 @@ typedef double       attr_type;
 typedef double       rank_type;
 // typedef float       rank_type;
 
+// Progress of an iterative solver : called after each of its steps with the
+// step number and the change the step made (max-norm). Returning false
+// stops the solver, which keeps the ranks reached so far.
+typedef std::function<bool(unsigned int, rank_type)> ProgressCallback;
+
 // This type represents a set of neighbors which a given Node points to.
 // For each Neighbor, this also keeps the attributes of the 
 // Node ---[attrib]----> Neighbor edge
-typedef map<node_id_type, attr_type> neighbor_set_type;
-typedef map<node_id_type, attr_type>::const_iterator attr_citer;
-typedef map<node_id_type, attr_type>::iterator attr_iter;
+// The sets of a Network are allocated from its arenas (Arena.h).
+typedef std::pmr::map<node_id_type, attr_type> neighbor_set_type;
+typedef neighbor_set_type::const_iterator attr_citer;
+typedef neighbor_set_type::iterator attr_iter;
 
 // This type represents a set of neighbors pointing to a given Node.
 // Neighbor -------> Node
 // This does NOT contain the edge attributes as they are kept in the
 // Node's forward links (ie. above neighbor_set_type)
-typedef set<node_id_type> back_neighbor_set_type;
-typedef set<node_id_type>::const_iterator back_neighbor_citer;
+typedef std::pmr::set<node_id_type> back_neighbor_set_type;
+typedef back_neighbor_set_type::const_iterator back_neighbor_citer;
 
 class Node;
 
@@ -0,0 +1,279 @@
+#!/bin/sh
+#
+# Copyright (c) 2012 Chammika Mannakkara
+#
+#    perftest.sh - End-to-end correctness and performance regression suite
+#                  (make perftest)
+#
+#    This is a part of simple tool calculate the PageRank
+#
+#    This source code is free software; you can redistribute it
+#    and/or modify it in source code form under the terms of the GNU
+#    General Public License as published by the Free Software
+#    Foundation; either version 2 of the License, or (at your option)
+#    any later version.
+#
+#    This program is distributed in the hope that it will be useful,
+#    but WITHOUT ANY WARRANTY; without even the implied warranty of
+#    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#    GNU General Public License for more details.
+#
+#    You should have received a copy of the GNU General Public License
+#    along with this program; if not, write to the Free Software
+#    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+#
+# usage : perftest.sh <pagerank_binary>
+#
+# 1. Every input graph of test/ is run through check, run (all solvers and
+#    options), analyze, sweep and --score pagerank. Leaks and sink groups must
+#    match test/golden/<input>.check exactly, ranks must match the golden
+#    vector test/golden/<input>.ranks within a relative tolerance (the top
+#    ranked URLs only with --stable-top). A run diffed against its own rank
+#    snapshot must report no change.
+# 2. Large graphs are generated, and timed with each solver. Their ranks must
+#    match the power iteration's within the tolerance. The time of a case is
+#    the one of its calculation phases, as exported by --perf-export (the
+#    solver, or the leak and sink searches) : reading the graph and building
+#    the link structure are not timed. It must not exceed the one of the
+#    baseline by more than the threshold. The baseline holds the times of
+#    this machine (make perftest-baseline) : without one, the times are only
+#    reported.
+#
+# Environment :
+#   PERFTEST_UPDATE=yes   rewrite the golden outputs and the baseline
+#                         (make perftest-baseline) instead of comparing
+#   PERFTEST_BASELINE     baseline file (default : perf_baseline next to the
+#                         pagerank binary)
+#   PERFTEST_THRESHOLD    allowed slow down, as a fraction (default 0.25)
+#   PERFTEST_REPEAT       timed runs per case, the best one counts (default 3)
+#   PERFTEST_NODES        nodes of the generated graphs (default 100000)
+
+BIN=${1:-bin/pagerank}
+TESTDIR=$(dirname "$0")
+GOLDEN=$TESTDIR/golden
+BASELINE=${PERFTEST_BASELINE:-$(dirname "$BIN")/perf_baseline}
+UPDATE=${PERFTEST_UPDATE:-no}
+THRESHOLD=${PERFTEST_THRESHOLD:-0.25}
+REPEAT=${PERFTEST_REPEAT:-3}
+NODES=${PERFTEST_NODES:-100000}
+
+# ranks printed with 6 significant digits : relative tolerance of a few units
+# in the last digit, float ranks get 1e-4
+RTOL=2e-5
+RTOL_FLOAT=1e-4
+# timer noise of the short calculations, allowed on top of the threshold
+SLACK=0.01
+
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+failures=0
+cases=0
+
+if [ ! -x "$BIN" ]; then
+  echo "perftest : no pagerank binary at $BIN"
+  exit 1
+fi
+mkdir -p "$GOLDEN"
+
+fail() {
+  echo "FAIL $*"
+  failures=$((failures + 1))
+}
+
+# rank lines of an output : "<rank>\t<url>"
+ranks() {
+  awk -F'\t' 'NF == 2 && $1 ~ /^[-+0-9.eE]+$/'
+}
+
+# leak and sink lines of a check/analyze output (up to the ranks)
+checks() {
+  sed -n '/^PageRanks :/q;p' | grep -v -e '^Reading' -e '^Network Reading' -e '^Number of' \
+    -e '^Finding' -e '^Analysis' -e '^Input format'
+}
+
+# compare_ranks <golden> <result> <rtol> : same URLs in the same order and
+# |rank - golden| <= rtol x |golden| (+ 1e-12)
+compare_ranks() {
+  [ "$(wc -l < "$1")" -eq "$(wc -l < "$2")" ] || return 1
+  paste "$1" "$2" | awk -F'\t' -v rtol="$3" '
+    { d = $1 - $3; if (d < 0) d = -d; g = ($1 < 0)? -$1 : $1
+      if ($2 != $4 || d > rtol * g + 1e-12) { bad++; if (bad <= 3) print "  " $0 } }
+    END { exit (bad > 0) }'
+}
+
+# URLs of the n best ranks, best first (equal ranks : in ID order)
+top_urls() {
+  sort -s -t"$(printf '\t')" -k1,1gr | head -n "$1" | cut -f2
+}
+
+# -- 1. golden outputs of the test inputs --
+
+RUN="run 0.85 1000 -e 1e-12 -l 1"
+for input in "$TESTDIR"/*; do
+  [ -f "$input" ] || continue
+  name=$(basename "$input")
+  case $name in *.sh) continue ;; esac
+
+  "$BIN" "$input" check -l 1 | checks > "$WORK/check"
+  "$BIN" "$input" $RUN | ranks > "$WORK/ranks"
+  if [ "$UPDATE" = yes ]; then
+    cp "$WORK/check" "$GOLDEN/$name.check"
+    cp "$WORK/ranks" "$GOLDEN/$name.ranks"
+  fi
+
+  cases=$((cases + 1))
+  cmp -s "$WORK/check" "$GOLDEN/$name.check" || fail "$name : check (leaks/sinks)"
+
+  "$BIN" "$input" analyze 0.85 1000 -e 1e-12 -l 1 > "$WORK/analyze"
+  cases=$((cases + 1))
+  checks < "$WORK/analyze" | cmp -s - "$GOLDEN/$name.check" || fail "$name : analyze (leaks/sinks)"
+  ranks < "$WORK/analyze" > "$WORK/out"
+  cases=$((cases + 1))
+  compare_ranks "$GOLDEN/$name.ranks" "$WORK/out" $RTOL || fail "$name : analyze (ranks)"
+
+  # snapshots of the edge stream : the last one is the whole network
+  "$BIN" "$input" $RUN --snapshots 0.5,1.0 --snapshot-prefix "$WORK/snapshot" > "$WORK/out"
+  last=$(sed -n 's/^PageRanks written to //p' "$WORK/out" | tail -1)
+  cases=$((cases + 1))
+  compare_ranks "$GOLDEN/$name.ranks" "$last" $RTOL || fail "$name : snapshots"
+  rm -f "$WORK"/snapshot.*
+
+  # recompute : the second solve on the same network (back node sets
+  # released by the first one) gives the same ranks
+  "$BIN" "$input" $RUN --snapshots 1.0,1.0 --snapshot-prefix "$WORK/snapshot" > "$WORK/out"
+  last=$(sed -n 's/^PageRanks written to //p' "$WORK/out" | tail -1)
+  cases=$((cases + 1))
+  [ "$(grep -c '^PageRanks written to' "$WORK/out")" -eq 2 ] && compare_ranks "$GOLDEN/$name.ranks" "$last" $RTOL \
+    || fail "$name : recompute"
+  rm -f "$WORK"/snapshot.*
+
+  # rank snapshot : a run diffed against its own snapshot has no changes
+  "$BIN" "$input" $RUN --rank-snapshot "$WORK/ranks.snap" | ranks > "$WORK/out"
+  "$BIN" "$input" $RUN --diff-against "$WORK/ranks.snap" > "$WORK/diff"
+  cases=$((cases + 1))
+  compare_ranks "$GOLDEN/$name.ranks" "$WORK/out" $RTOL && ! grep -q '^[-+~]	' "$WORK/diff" \
+    || fail "$name : rank snapshot diff"
+
+  # stable top-K : stops early, the 10 best ranked URLs are the golden ones
+  "$BIN" "$input" $RUN --stable-top 10 --patience 5 | ranks | top_urls 10 > "$WORK/out"
+  cases=$((cases + 1))
+  top_urls 10 < "$GOLDEN/$name.ranks" | cmp -s - "$WORK/out" || fail "$name : stable-top"
+
+  while read -r label args; do
+    "$BIN" "$input" $args | ranks > "$WORK/out"
+    tol=$RTOL
+    case $label in float) tol=$RTOL_FLOAT ;; esac
+    cases=$((cases + 1))
+    compare_ranks "$GOLDEN/$name.ranks" "$WORK/out" $tol || fail "$name : $label"
+  done <<EOF
+power $RUN
+plan $RUN --plan
+threads $RUN -t 2
+float $RUN --precision float
+scc $RUN --solver scc
+gmres $RUN --solver gmres
+bicgstab $RUN --solver bicgstab
+delta $RUN --solver delta
+gmres-noprecond $RUN --solver gmres --precond none
+quadratic $RUN --extrapolate quadratic
+blockrank $RUN --init blockrank
+score $RUN --score pagerank
+sweep sweep 0.85 1000 -e 1e-12 -l 1
+EOF
+done
+
+# -- 2. generated graphs : timing --
+
+# gen_graph <nodes> <skew> : node i links to the next node (a ring over all
+# but the last 1% of the nodes, which are rank leaks) and to 9 pseudo random
+# nodes, picked uniformly (skew 1) or among the low IDs (skew 3 : in-link
+# counts follow a power law). Park-Miller generator : the same graph with
+# any awk.
+gen_graph() {
+  awk -v N="$1" -v skew="$2" 'BEGIN {
+    seed = 12345; leaks = int(N / 100); last = N - leaks
+    for (i = 0; i < N; ++i) {
+      if (i >= last) continue
+      print "n" i " n" ((i + 1) % last)
+      for (k = 0; k < 9; ++k) {
+        seed = (seed * 16807) % 2147483647
+        u = seed / 2147483647; j = int(N * u ^ skew)
+        if (j != i) print "n" i " n" j
+      }
+    }
+  }'
+}
+
+# calc_seconds <perf_csv> : seconds of the calculation phases of a run, ie.
+# the phases of --perf-export (not their iterations) but the link structure
+# build and the plan
+calc_seconds() {
+  awk -F, 'NR > 1 && $2 == 0 && $1 != "build" && $1 != "plan" { t += $4 }
+    END { printf "%.6f", t }' "$1"
+}
+
+# time_case <case> <graph> <args...> : best calculation time of REPEAT runs,
+# output of the last run in $WORK/out
+time_case() {
+  tcase=$1 graph=$2
+  shift 2
+  best=
+  r=0
+  while [ $r -lt "$REPEAT" ]; do
+    "$BIN" "$graph" "$@" --perf --perf-export "$WORK/perf.csv" > "$WORK/out"
+    t=$(calc_seconds "$WORK/perf.csv")
+    best=$(awk -v t="$t" -v b="$best" 'BEGIN { print (b == "" || t < b)? t : b }')
+    r=$((r + 1))
+  done
+  edges=$(wc -l < "$graph")
+  rate=$(awk -v t="$best" -v e="$edges" 'BEGIN { printf "%.0f", (t > 0)? e / t : 0 }')
+  echo "$tcase $best $rate" >> "$WORK/timings"
+  base=$(awk -v c="$tcase" '$1 == c { print $2 }' "$BASELINE" 2>/dev/null)
+  cases=$((cases + 1))
+  if [ -z "$base" ]; then
+    printf "%-32s %8.3f s %12s edges/s  (no baseline)\n" "$tcase" "$best" "$rate"
+  elif awk -v t="$best" -v b="$base" -v x="$THRESHOLD" -v s="$SLACK" 'BEGIN { exit !(t > b * (1 + x) + s) }'; then
+    printf "%-32s %8.3f s %12s edges/s  baseline %s s\n" "$tcase" "$best" "$rate" "$base"
+    fail "$tcase : $best s, baseline $base s (threshold $THRESHOLD + $SLACK s)"
+  else
+    printf "%-32s %8.3f s %12s edges/s  baseline %s s\n" "$tcase" "$best" "$rate" "$base"
+  fi
+}
+
+: > "$WORK/timings"
+for graph in uniform:1 skewed:3; do
+  gname=gen-${graph%%:*}
+  gen_graph "$NODES" "${graph##*:}" > "$WORK/$gname.net"
+  GRAPH=$WORK/$gname.net
+  RUN="run 0.85 200 -e 1e-10 -l 1"
+
+  time_case "$gname/check" "$GRAPH" check -l 1
+  time_case "$gname/power" "$GRAPH" $RUN
+  ranks < "$WORK/out" > "$WORK/$gname.ranks"
+  while read -r label args; do
+    time_case "$gname/$label" "$GRAPH" $args
+    tol=$RTOL
+    case $label in float) tol=$RTOL_FLOAT ;; esac
+    cases=$((cases + 1))
+    ranks < "$WORK/out" > "$WORK/ranks"
+    compare_ranks "$WORK/$gname.ranks" "$WORK/ranks" $tol || fail "$gname : $label (ranks)"
+  done <<EOF
+power-t2 $RUN -t 2
+float $RUN --precision float
+scc $RUN --solver scc
+gmres $RUN --solver gmres
+bicgstab $RUN --solver bicgstab
+delta $RUN --solver delta
+quadratic $RUN --extrapolate quadratic
+analyze analyze 0.85 200 -e 1e-10 -l 1
+EOF
+done
+
+if [ "$UPDATE" = yes ]; then
+  { echo "# case calc_seconds edges_per_second (best of $REPEAT runs, $NODES nodes)"
+    cat "$WORK/timings"; } > "$BASELINE"
+  echo "perftest : golden outputs and baseline ($BASELINE) updated"
+fi
+
+echo "perftest : $cases cases, $failures failure(s)"
+[ $failures -eq 0 ]